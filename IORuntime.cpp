@@ -0,0 +1,75 @@
+/*
+  ==============================================================================
+
+	IORuntime.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+IORuntime::IORuntime(int numThreads) :
+	ioService(std::make_shared<asio::io_service>()),
+	work(new asio::io_service::work(*ioService))
+{
+	for (int i = 0; i < jmax(1, numThreads); i++)
+	{
+		// The thread holds the io_service, so that it can outlive the runtime when it has to be detached, see the destructor
+		std::shared_ptr<asio::io_service> service = ioService;
+		threads.emplace_back([service]()
+			{
+				Thread::setCurrentThreadName("Web socket io");
+				for (;;)
+				{
+					try
+					{
+						service->run();
+						return;
+					}
+					catch (std::exception& e)
+					{
+						DBG("Error in io thread " << e.what());
+					}
+				}
+			});
+	}
+}
+
+IORuntime::~IORuntime()
+{
+	work.reset();
+	ioService->stop();
+
+	// The last user may release the runtime from one of its own handlers, and a thread can't join itself
+	const std::thread::id current = std::this_thread::get_id();
+	for (auto& t : threads)
+	{
+		if (t.get_id() == current) t.detach();
+		else if (t.joinable()) t.join();
+	}
+}
+
+std::shared_ptr<IORuntime> IORuntime::getShared()
+{
+	static std::mutex sharedLock;
+	static std::weak_ptr<IORuntime> shared;
+
+	std::lock_guard<std::mutex> lock(sharedLock);
+	std::shared_ptr<IORuntime> runtime = shared.lock();
+	if (runtime == nullptr)
+	{
+		runtime = std::make_shared<IORuntime>();
+		shared = runtime;
+	}
+	return runtime;
+}
+
+bool IORuntime::isIOThread() const
+{
+	const std::thread::id current = std::this_thread::get_id();
+	for (auto& t : threads) if (t.get_id() == current) return true;
+	return false;
+}
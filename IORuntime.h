@@ -0,0 +1,38 @@
+/*
+  ==============================================================================
+
+	IORuntime.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief A fixed pool of threads running one io_service, which servers and clients can share instead of each
+/// running a thread of its own. Set SimpleWebSocketServerBase::ioRuntime or SimpleWebSocketClientBase::ioRuntime
+/// before start(). They are null by default, and each instance then keeps its own thread.
+/// Handlers of one connection may then run on any of the threads, so listeners must not assume a single thread.
+class IORuntime
+{
+public:
+	IORuntime(int numThreads = juce::SystemStats::getNumCpus());
+	~IORuntime();
+
+	/// @brief The process-wide runtime, with one thread per core. It is created on first use and destroyed once
+	/// the last server or client holding it releases it.
+	static std::shared_ptr<IORuntime> getShared();
+
+	std::shared_ptr<asio::io_service> getIOService() const { return ioService; }
+	int getNumThreads() const { return (int)threads.size(); }
+
+	/// @brief Returns true when called from one of the runtime's threads, i.e. from a server or client handler.
+	bool isIOThread() const;
+
+private:
+	std::shared_ptr<asio::io_service> ioService;
+	std::unique_ptr<asio::io_service::work> work;
+	std::vector<std::thread> threads;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(IORuntime)
+};
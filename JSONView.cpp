@@ -0,0 +1,369 @@
+/*
+  ==============================================================================
+
+	JSONView.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+JSONView::JSONView(const WebSocketPayload& payload) :
+	JSONView(payload.getOwner(), payload.getData(), payload.getData() + payload.getSize(), false)
+{
+}
+
+JSONView::JSONView(const char* data, size_t size) :
+	JSONView(nullptr, data, data + size, false)
+{
+}
+
+JSONView::JSONView(const std::shared_ptr<const void>& _owner, const char* _begin, const char* _end, bool delimited) :
+	owner(_owner)
+{
+	if (_begin == nullptr) return;
+
+	begin = skipSpace(_begin, _end);
+	end = _end;
+	while (end != begin && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) end--;
+	if (begin == end) return;
+
+	switch (*begin)
+	{
+	case '{': type = Object; break;
+	case '[': type = Array; break;
+	case '"': type = Text; break;
+	case 't': case 'f': type = Boolean; break;
+	case 'n': type = Null; break;
+	default: type = (*begin == '-' || (*begin >= '0' && *begin <= '9')) ? Number : Invalid; break;
+	}
+
+	// Strings, objects and arrays are read up to their closing character, which untrusted text may not have where it should
+	if (!delimited && (type == Text || type == Object || type == Array) && skipValue(begin, end) != end) type = Invalid;
+}
+
+template <class Callback>
+void JSONView::scan(Callback callback) const
+{
+	// callback(keyBegin, keyEnd, valueBegin, valueEnd) returns true to stop. Keys are null for arrays.
+	if (type != Object && type != Array) return;
+
+	const char close = type == Object ? '}' : ']';
+	const char* p = skipSpace(begin + 1, end);
+	if (p != end && *p == close) return;
+
+	while (p != end)
+	{
+		const char* keyBegin = nullptr;
+		const char* keyEnd = nullptr;
+
+		if (type == Object)
+		{
+			if (*p != '"') return;
+			keyBegin = p + 1;
+			p = skipString(p, end);
+			if (p == nullptr) return;
+			keyEnd = p - 1;
+
+			p = skipSpace(p, end);
+			if (p == end || *p++ != ':') return;
+			p = skipSpace(p, end);
+		}
+
+		const char* valueBegin = p;
+		p = skipValue(p, end);
+		if (p == nullptr || p == valueBegin) return;
+
+		if (callback(keyBegin, keyEnd, valueBegin, p)) return;
+
+		p = skipSpace(p, end);
+		if (p == end || *p != ',') return;
+		p = skipSpace(p + 1, end);
+	}
+}
+
+JSONView JSONView::operator[](const char* key) const
+{
+	JSONView result;
+	if (type != Object) return result;
+
+	const std::string_view k(key);
+	scan([&](const char* keyBegin, const char* keyEnd, const char* valueBegin, const char* valueEnd)
+		{
+			if (!stringEquals(keyBegin - 1, keyEnd + 1, k)) return false;
+			result = JSONView(owner, valueBegin, valueEnd, true);
+			return true;
+		});
+	return result;
+}
+
+JSONView JSONView::operator[](int index) const
+{
+	JSONView result;
+	if (type != Array || index < 0) return result;
+
+	int i = 0;
+	scan([&](const char*, const char*, const char* valueBegin, const char* valueEnd)
+		{
+			if (i++ != index) return false;
+			result = JSONView(owner, valueBegin, valueEnd, true);
+			return true;
+		});
+	return result;
+}
+
+int JSONView::size() const
+{
+	int count = 0;
+	scan([&](const char*, const char*, const char*, const char*) { count++; return false; });
+	return count;
+}
+
+void JSONView::forEachMember(const std::function<void(std::string_view key, const JSONView& value)>& callback) const
+{
+	if (type != Object) return;
+	scan([&](const char* keyBegin, const char* keyEnd, const char* valueBegin, const char* valueEnd)
+		{
+			callback(std::string_view(keyBegin, (size_t)(keyEnd - keyBegin)), JSONView(owner, valueBegin, valueEnd, true));
+			return false;
+		});
+}
+
+void JSONView::forEachElement(const std::function<void(const JSONView& value)>& callback) const
+{
+	if (type != Array) return;
+	scan([&](const char*, const char*, const char* valueBegin, const char* valueEnd)
+		{
+			callback(JSONView(owner, valueBegin, valueEnd, true));
+			return false;
+		});
+}
+
+bool JSONView::equals(std::string_view text) const
+{
+	return type == Text && stringEquals(begin, end, text);
+}
+
+String JSONView::toString() const
+{
+	if (type != Text) return String::fromUTF8(begin, (int)(end - begin));
+	if (std::memchr(begin, '\\', (size_t)(end - begin)) == nullptr) return String::fromUTF8(begin + 1, (int)(end - begin - 2));
+
+	const std::string s = unescape(begin, end);
+	return String::fromUTF8(s.data(), (int)s.size());
+}
+
+double JSONView::toDouble(double defaultValue) const
+{
+	if (type != Number) return defaultValue;
+
+	// strtod needs a terminated string, and numbers are short
+	char buffer[64];
+	const size_t length = jmin((size_t)(end - begin), sizeof(buffer) - 1);
+	memcpy(buffer, begin, length);
+	buffer[length] = 0;
+	return std::strtod(buffer, nullptr);
+}
+
+int64 JSONView::toInt64(int64 defaultValue) const
+{
+	if (type != Number) return defaultValue;
+
+	// Decimals, exponents and integers too long for int64 go through double, clamped to the range of int64
+	auto fromDouble = [this]
+		{
+			const double d = toDouble();
+			if (d >= 9223372036854775807.0) return std::numeric_limits<int64>::max();
+			if (d <= -9223372036854775808.0) return std::numeric_limits<int64>::min();
+			return (int64)d;
+		};
+
+	for (const char* p = begin; p != end; p++)
+		if (*p == '.' || *p == 'e' || *p == 'E') return fromDouble();
+
+	uint64 value = 0;
+	const bool negative = *begin == '-';
+	for (const char* p = negative ? begin + 1 : begin; p != end && *p >= '0' && *p <= '9'; p++)
+	{
+		const uint64 digit = (uint64)(*p - '0');
+		if (value > ((uint64)std::numeric_limits<int64>::max() - digit) / 10) return fromDouble();
+		value = value * 10 + digit;
+	}
+	return negative ? -(int64)value : (int64)value;
+}
+
+bool JSONView::toBool(bool defaultValue) const
+{
+	return type == Boolean ? *begin == 't' : defaultValue;
+}
+
+var JSONView::toVar() const
+{
+	switch (type)
+	{
+	case Null: return var();
+	case Boolean: return var(toBool());
+	case Text: return var(toString());
+	case Number:
+	{
+		// JSON::parse only takes an object or an array, so numbers are built here, typed like it types them
+		if (getRaw().find_first_of(".eE") != std::string_view::npos) return var(toDouble());
+		const int64 value = toInt64();
+		return value == (int)value ? var((int)value) : var(value);
+	}
+	case Array:
+	case Object: return JSON::parse(String::fromUTF8(begin, (int)(end - begin)));
+	default: return var::undefined();
+	}
+}
+
+const char* JSONView::skipSpace(const char* p, const char* end)
+{
+	while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+	return p;
+}
+
+const char* JSONView::skipString(const char* p, const char* end)
+{
+	// p is on the opening quote. Returns the position after the closing one, or nullptr.
+	for (p++; p != end; p++)
+	{
+		if (*p == '\\') { if (++p == end) return nullptr; }
+		else if (*p == '"') return p + 1;
+	}
+	return nullptr;
+}
+
+const char* JSONView::skipValue(const char* p, const char* end)
+{
+	if (p == end) return nullptr;
+	if (*p == '"') return skipString(p, end);
+
+	if (*p == '{' || *p == '[')
+	{
+		int depth = 0;
+		while (p != end)
+		{
+			if (*p == '"')
+			{
+				p = skipString(p, end);
+				if (p == nullptr) return nullptr;
+				continue;
+			}
+			if (*p == '{' || *p == '[') depth++;
+			else if ((*p == '}' || *p == ']') && --depth == 0) return p + 1;
+			p++;
+		}
+		return nullptr;
+	}
+
+	// Number, true, false or null
+	while (p != end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') p++;
+	return p;
+}
+
+bool JSONView::stringEquals(const char* begin, const char* end, std::string_view text)
+{
+	// begin and end include the quotes
+	const std::string_view raw(begin + 1, (size_t)(end - begin - 2));
+	if (raw.find('\\') == std::string_view::npos) return raw == text;
+	return unescape(begin, end) == text;
+}
+
+std::string JSONView::unescape(const char* begin, const char* end)
+{
+	std::string s;
+	s.reserve((size_t)(end - begin));
+
+	auto readHex = [&](const char* p) -> int
+		{
+			if (end - p < 4) return -1;
+			int value = 0;
+			for (int i = 0; i < 4; i++)
+			{
+				const int digit = CharacterFunctions::getHexDigitValue((juce_wchar)p[i]);
+				if (digit < 0) return -1;
+				value = (value << 4) | digit;
+			}
+			return value;
+		};
+
+	for (const char* p = begin + 1; p < end - 1; p++)
+	{
+		if (*p != '\\') { s += *p; continue; }
+		if (++p >= end - 1) break;
+
+		switch (*p)
+		{
+		case 'b': s += '\b'; break;
+		case 'f': s += '\f'; break;
+		case 'n': s += '\n'; break;
+		case 'r': s += '\r'; break;
+		case 't': s += '\t'; break;
+		case 'u':
+		{
+			int c = readHex(p + 1);
+			if (c < 0) break;
+			p += 4;
+
+			// Characters outside the BMP come as a surrogate pair
+			if (c >= 0xd800 && c <= 0xdbff && p + 2 < end && p[1] == '\\' && p[2] == 'u')
+			{
+				const int low = readHex(p + 3);
+				if (low >= 0xdc00 && low <= 0xdfff)
+				{
+					c = 0x10000 + ((c - 0xd800) << 10) + (low - 0xdc00);
+					p += 6;
+				}
+			}
+
+			if (c < 0x80) s += (char)c;
+			else if (c < 0x800) { s += (char)(0xc0 | (c >> 6)); s += (char)(0x80 | (c & 0x3f)); }
+			else if (c < 0x10000) { s += (char)(0xe0 | (c >> 12)); s += (char)(0x80 | ((c >> 6) & 0x3f)); s += (char)(0x80 | (c & 0x3f)); }
+			else { s += (char)(0xf0 | (c >> 18)); s += (char)(0x80 | ((c >> 12) & 0x3f)); s += (char)(0x80 | ((c >> 6) & 0x3f)); s += (char)(0x80 | (c & 0x3f)); }
+			break;
+		}
+		default: s += *p; break; // \" \\ and \/
+		}
+	}
+	return s;
+}
+
+#if JUCE_UNIT_TESTS
+
+class JSONViewTests : public UnitTest
+{
+public:
+	JSONViewTests() : UnitTest("JSONView", "SimpleWeb") {}
+
+	void runTest() override
+	{
+		beginTest("toVar of values that are not objects or arrays");
+
+		const var integer = JSONView("42", 2).toVar();
+		expect(integer.isInt());
+		expectEquals((int)integer, 42);
+
+		const var decimal = JSONView("1.5", 3).toVar();
+		expect(decimal.isDouble());
+		expectEquals((double)decimal, 1.5);
+
+		expect(JSONView("-3e2", 4).toVar().isDouble());
+		expect(JSONView("5000000000", 10).toVar().isInt64());
+		expect(JSONView("true", 4).toVar().isBool());
+		expect(JSONView("null", 4).toVar().isVoid());
+		expectEquals(JSONView("\"a\"", 3).toVar().toString(), String("a"));
+
+		beginTest("Unclosed text");
+
+		expect(!JSONView("\"", 1).isValid());
+		expect(!JSONView("{\"a\":1", 6).isValid());
+	}
+};
+
+static JSONViewTests jsonViewTests;
+
+#endif
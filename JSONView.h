@@ -0,0 +1,83 @@
+/*
+  ==============================================================================
+
+	JSONView.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief A read-only view over JSON text that parses nothing until asked. Looking up a member or an element scans
+/// the text in place and returns another view, so routing a message on one field costs no allocation, unlike
+/// juce::JSON::parse which builds the whole var tree and interns every key. toVar() builds a var when one is needed.
+/// Malformed text is mostly not reported up front: a string, object or array not closed where the text ends makes the
+/// view invalid, and otherwise the lookups that run into bad text return invalid views.
+class JSONView
+{
+public:
+	enum Type { Invalid, Null, Boolean, Number, Text, Array, Object };
+
+	JSONView() {}
+
+	/// @brief Views a text message, e.g. from Listener::payloadReceived. The view and its children keep the payload alive.
+	explicit JSONView(const WebSocketPayload& payload);
+
+	/// @brief Views data, which must outlive the view and its children.
+	JSONView(const char* data, size_t size);
+
+	Type getType() const { return type; }
+	bool isValid() const { return type != Invalid; }
+	bool isNull() const { return type == Null; }
+	bool isBool() const { return type == Boolean; }
+	bool isNumber() const { return type == Number; }
+	bool isString() const { return type == Text; }
+	bool isArray() const { return type == Array; }
+	bool isObject() const { return type == Object; }
+
+	/// @brief The value of a member of an object, invalid if there is none or this is not an object.
+	/// Each lookup scans the object from its start, so keep the views of members used more than once.
+	JSONView operator[](const char* key) const;
+	JSONView operator[](int index) const;
+	bool hasProperty(const char* key) const { return (*this)[key].isValid(); }
+
+	/// @brief The number of members or elements, which takes a scan. 0 for other types.
+	int size() const;
+
+	/// @brief Keys are given as they appear in the text, without the quotes and still escaped.
+	void forEachMember(const std::function<void(std::string_view key, const JSONView& value)>& callback) const;
+	void forEachElement(const std::function<void(const JSONView& value)>& callback) const;
+
+	/// @brief The JSON text of the value.
+	std::string_view getRaw() const { return std::string_view(begin, (size_t)(end - begin)); }
+
+	/// @brief Compares the value of a string with text, unescaping it only if it has escape sequences.
+	bool equals(std::string_view text) const;
+
+	/// @brief The value of a string, or the JSON text of other types.
+	juce::String toString() const;
+	double toDouble(double defaultValue = 0) const;
+	juce::int64 toInt64(juce::int64 defaultValue = 0) const;
+	bool toBool(bool defaultValue = false) const;
+
+	/// @brief Builds the var of the value: objects and arrays with juce::JSON::parse, other values directly.
+	juce::var toVar() const;
+
+private:
+	/// delimited is true for values found by skipValue(), whose strings, objects and arrays are known to be closed
+	JSONView(const std::shared_ptr<const void>& owner, const char* begin, const char* end, bool delimited);
+
+	template <class Callback> void scan(Callback callback) const;
+
+	static const char* skipSpace(const char* p, const char* end);
+	static const char* skipString(const char* p, const char* end);
+	static const char* skipValue(const char* p, const char* end);
+	static bool stringEquals(const char* begin, const char* end, std::string_view text);
+	static std::string unescape(const char* begin, const char* end);
+
+	std::shared_ptr<const void> owner; // What the text belongs to, if the view keeps it alive
+	const char* begin = nullptr; // First character of the value
+	const char* end = nullptr; // Past its last character
+	Type type = Invalid;
+};
@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+	MessagePack.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+namespace
+{
+	/// Gathers the small writes of the encoder, so that the stream is called once every few hundred bytes
+	class MessagePackWriter
+	{
+	public:
+		MessagePackWriter(std::streambuf& _out) : out(_out) {}
+		~MessagePackWriter() { flush(); }
+
+		void write(const var& v)
+		{
+			if (v.isBool()) putByte((bool)v ? 0xc3 : 0xc2);
+			else if (v.isInt()) writeInt((int)v);
+			else if (v.isInt64()) writeInt((int64)v);
+			else if (v.isDouble()) putBigEndian(0xcb, doubleBits((double)v), 8);
+			else if (v.isString())
+			{
+				const String s = v.toString();
+				writeHeader(s.getNumBytesAsUTF8(), 0xa0, 32, 0xd9);
+				put(s.toRawUTF8(), s.getNumBytesAsUTF8());
+			}
+			else if (v.isBinaryData())
+			{
+				const MemoryBlock* b = v.getBinaryData();
+				const size_t size = b->getSize();
+				if (size <= 0xff) putBigEndian(0xc4, size, 1);
+				else if (size <= 0xffff) putBigEndian(0xc5, size, 2);
+				else putBigEndian(0xc6, size, 4);
+				put(b->getData(), size);
+			}
+			else if (v.isArray())
+			{
+				const Array<var>* a = v.getArray();
+				writeHeader((size_t)a->size(), 0x90, 16, 0xdc);
+				for (auto& e : *a) write(e);
+			}
+			else if (DynamicObject* o = v.getDynamicObject())
+			{
+				NamedValueSet& properties = o->getProperties();
+				writeHeader((size_t)properties.size(), 0x80, 16, 0xde);
+				for (auto& p : properties)
+				{
+					const String key = p.name.toString();
+					writeHeader(key.getNumBytesAsUTF8(), 0xa0, 32, 0xd9);
+					put(key.toRawUTF8(), key.getNumBytesAsUTF8());
+					write(p.value);
+				}
+			}
+			else putByte(0xc0); // void, undefined and methods
+		}
+
+	private:
+		void writeInt(int64 v)
+		{
+			if (v >= 0)
+			{
+				if (v < 0x80) putByte((uint8)v);
+				else if (v <= 0xff) putBigEndian(0xcc, (uint64)v, 1);
+				else if (v <= 0xffff) putBigEndian(0xcd, (uint64)v, 2);
+				else if (v <= 0xffffffffLL) putBigEndian(0xce, (uint64)v, 4);
+				else putBigEndian(0xcf, (uint64)v, 8);
+			}
+			else
+			{
+				if (v >= -32) putByte((uint8)(int8)v);
+				else if (v >= -128) putBigEndian(0xd0, (uint64)v, 1);
+				else if (v >= -32768) putBigEndian(0xd1, (uint64)v, 2);
+				else if (v >= -2147483647LL - 1) putBigEndian(0xd2, (uint64)v, 4);
+				else putBigEndian(0xd3, (uint64)v, 8);
+			}
+		}
+
+		/// Strings, arrays and maps have a fixed form for small sizes, then 8 (strings only), 16 and 32 bit lengths
+		void writeHeader(size_t size, uint8 fixType, size_t fixLimit, uint8 firstType)
+		{
+			if (size < fixLimit) putByte((uint8)(fixType | size));
+			else if (firstType == 0xd9 && size <= 0xff) putBigEndian(0xd9, size, 1);
+			else if (size <= 0xffff) putBigEndian(firstType == 0xd9 ? 0xda : firstType, size, 2);
+			else putBigEndian(firstType == 0xd9 ? 0xdb : firstType + 1, size, 4);
+		}
+
+		static uint64 doubleBits(double d)
+		{
+			uint64 bits;
+			memcpy(&bits, &d, sizeof(bits));
+			return bits;
+		}
+
+		void putByte(uint8 b)
+		{
+			if (used == sizeof(buffer)) flush();
+			buffer[used++] = (char)b;
+		}
+
+		void putBigEndian(uint8 type, uint64 v, int numBytes)
+		{
+			char b[9];
+			b[0] = (char)type;
+			for (int i = 0; i < numBytes; i++) b[1 + i] = (char)(v >> (8 * (numBytes - 1 - i)));
+			put(b, (size_t)numBytes + 1);
+		}
+
+		void put(const void* data, size_t size)
+		{
+			if (used + size > sizeof(buffer))
+			{
+				flush();
+				if (size > sizeof(buffer))
+				{
+					out.sputn((const char*)data, (std::streamsize)size);
+					return;
+				}
+			}
+			memcpy(buffer + used, data, size);
+			used += size;
+		}
+
+		void flush()
+		{
+			if (used > 0) out.sputn(buffer, (std::streamsize)used);
+			used = 0;
+		}
+
+		std::streambuf& out;
+		char buffer[256];
+		size_t used = 0;
+	};
+
+	class MessagePackReader
+	{
+	public:
+		MessagePackReader(const char* data, size_t size) : p((const uint8*)data), end((const uint8*)data + size) {}
+
+		bool read(var& result, int depth)
+		{
+			if (depth > MessagePack::maxDepth || !has(1)) return false;
+			const uint8 type = *p++;
+
+			if (type <= 0x7f) { result = (int)type; return true; }
+			if (type >= 0xe0) { result = (int)(int8)type; return true; }
+			if ((type & 0xf0) == 0x80) return readMap(type & 0x0f, result, depth);
+			if ((type & 0xf0) == 0x90) return readArray(type & 0x0f, result, depth);
+			if ((type & 0xe0) == 0xa0) return readString(type & 0x1f, result);
+
+			size_t size = 0;
+			switch (type)
+			{
+			case 0xc0: result = var(); return true;
+			case 0xc2: result = false; return true;
+			case 0xc3: result = true; return true;
+
+			case 0xc4: case 0xc5: case 0xc6:
+				if (!readLength(1 << (type - 0xc4), size) || !has(size)) return false;
+				result = var(MemoryBlock(p, size));
+				p += size;
+				return true;
+
+			case 0xca:
+			{
+				if (!has(4)) return false;
+				const uint32 bits = (uint32)readBigEndian(4);
+				float f;
+				memcpy(&f, &bits, sizeof(f));
+				result = (double)f;
+				return true;
+			}
+			case 0xcb:
+			{
+				if (!has(8)) return false;
+				const uint64 bits = readBigEndian(8);
+				double d;
+				memcpy(&d, &bits, sizeof(d));
+				result = d;
+				return true;
+			}
+
+			case 0xcc: case 0xcd: case 0xce: case 0xcf:
+			{
+				const int numBytes = 1 << (type - 0xcc);
+				if (!has((size_t)numBytes)) return false;
+				const uint64 v = readBigEndian(numBytes);
+				if (v <= (uint64)std::numeric_limits<int>::max()) result = (int)v;
+				else if (v <= (uint64)std::numeric_limits<int64>::max()) result = (int64)v;
+				else result = (double)v;
+				return true;
+			}
+			case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+			{
+				const int numBytes = 1 << (type - 0xd0);
+				if (!has((size_t)numBytes)) return false;
+				const int shift = 64 - 8 * numBytes;
+				const int64 v = (int64)(readBigEndian(numBytes) << shift) >> shift; // Sign extension
+				if (v >= std::numeric_limits<int>::min() && v <= std::numeric_limits<int>::max()) result = (int)v;
+				else result = v;
+				return true;
+			}
+
+			case 0xd9: case 0xda: case 0xdb:
+				return readLength(1 << (type - 0xd9), size) && readString(size, result);
+			case 0xdc: case 0xdd:
+				return readLength(type == 0xdc ? 2 : 4, size) && readArray(size, result, depth);
+			case 0xde: case 0xdf:
+				return readLength(type == 0xde ? 2 : 4, size) && readMap(size, result, depth);
+
+			// Extension types have no var counterpart and read as void
+			case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+				return skip(1 + ((size_t)1 << (type - 0xd4)), result);
+			case 0xc7: case 0xc8: case 0xc9:
+				return readLength(1 << (type - 0xc7), size) && skip(1 + size, result);
+
+			default: return false; // 0xc1 is never used
+			}
+		}
+
+		bool isAtEnd() const { return p == end; }
+
+	private:
+		bool has(size_t n) const { return (size_t)(end - p) >= n; }
+
+		uint64 readBigEndian(int numBytes)
+		{
+			uint64 v = 0;
+			for (int i = 0; i < numBytes; i++) v = (v << 8) | *p++;
+			return v;
+		}
+
+		bool readLength(int numBytes, size_t& size)
+		{
+			if (!has((size_t)numBytes)) return false;
+			size = (size_t)readBigEndian(numBytes);
+			return true;
+		}
+
+		bool readString(size_t size, var& result)
+		{
+			if (!has(size)) return false;
+			result = String::fromUTF8((const char*)p, (int)size);
+			p += size;
+			return true;
+		}
+
+		bool readArray(size_t size, var& result, int depth)
+		{
+			// Each element takes at least a byte, which bounds what a forged length can make us allocate
+			if (!has(size)) return false;
+
+			Array<var> a;
+			a.ensureStorageAllocated((int)size);
+			for (size_t i = 0; i < size; i++)
+			{
+				var e;
+				if (!read(e, depth + 1)) return false;
+				a.add(std::move(e));
+			}
+			result = std::move(a);
+			return true;
+		}
+
+		bool readMap(size_t size, var& result, int depth)
+		{
+			if (size > (size_t)(end - p) / 2) return false;
+
+			DynamicObject::Ptr o = new DynamicObject();
+			for (size_t i = 0; i < size; i++)
+			{
+				var key, value;
+				if (!read(key, depth + 1) || !read(value, depth + 1)) return false;
+
+				const String name = key.toString();
+				if (name.isNotEmpty()) o->setProperty(name, value);
+			}
+			result = var(o.get());
+			return true;
+		}
+
+		bool skip(size_t size, var& result)
+		{
+			if (!has(size)) return false;
+			p += size;
+			result = var();
+			return true;
+		}
+
+		const uint8* p;
+		const uint8* const end;
+	};
+
+	/// Appends what the encoder writes to a MemoryBlock
+	class MemoryBlockStreamBuffer : public std::streambuf
+	{
+	public:
+		MemoryBlock block;
+
+	protected:
+		std::streamsize xsputn(const char* s, std::streamsize n) override
+		{
+			block.append(s, (size_t)n);
+			return n;
+		}
+
+		int_type overflow(int_type c) override
+		{
+			if (c != traits_type::eof())
+			{
+				const char ch = (char)c;
+				block.append(&ch, 1);
+			}
+			return traits_type::not_eof(c);
+		}
+	};
+}
+
+void MessagePack::write(std::streambuf& out, const var& value)
+{
+	MessagePackWriter writer(out);
+	writer.write(value);
+}
+
+MemoryBlock MessagePack::toMemoryBlock(const var& value)
+{
+	MemoryBlockStreamBuffer buffer;
+	write(buffer, value);
+	return std::move(buffer.block);
+}
+
+Result MessagePack::parse(const char* data, size_t size, var& result)
+{
+	MessagePackReader reader(data, size);
+	var value;
+	if (!reader.read(value, 0)) return Result::fail("Invalid MessagePack data");
+	if (!reader.isAtEnd()) return Result::fail("Unexpected data after the MessagePack value");
+
+	result = value;
+	return Result::ok();
+}
+
+var MessagePack::parse(const char* data, size_t size)
+{
+	var result;
+	parse(data, size, result);
+	return result;
+}
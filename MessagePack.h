@@ -0,0 +1,33 @@
+/*
+  ==============================================================================
+
+	MessagePack.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief Converts juce::var to and from MessagePack, a binary counterpart of JSON that is smaller and much cheaper
+/// to write and read: numbers keep their binary form and strings are copied as they are, with their length up front.
+/// Objects become maps with string keys, arrays become arrays, and MemoryBlocks become bin. Methods and undefined
+/// are written as nil. Integers are read back as int when they fit, else as int64, and floats as double.
+/// Send with sendMessagePack() on a server or a client, and read dataReceived or payloadReceived data with parse().
+class MessagePack
+{
+public:
+	/// @brief Appends the encoding of value to out, e.g. the buffer of a WebSocket OutMessage, without building it elsewhere first.
+	static void write(std::streambuf& out, const juce::var& value);
+	static void write(std::ostream& out, const juce::var& value) { write(*out.rdbuf(), value); }
+
+	static juce::MemoryBlock toMemoryBlock(const juce::var& value);
+
+	/// @brief Decodes one value from data. The result is void if data is not valid MessagePack.
+	static juce::Result parse(const char* data, size_t size, juce::var& result);
+	static juce::var parse(const char* data, size_t size);
+	static juce::var parse(const juce::MemoryBlock& data) { return parse((const char*)data.getData(), data.getSize()); }
+	static juce::var parse(const WebSocketPayload& payload) { return parse(payload.getData(), payload.getSize()); }
+
+	static const int maxDepth = 256; // Nesting beyond this is rejected, so that a hostile message can't exhaust the stack
+};
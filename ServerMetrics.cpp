@@ -0,0 +1,173 @@
+/*
+  ==============================================================================
+
+	ServerMetrics.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+namespace
+{
+	const double latencyBucketBounds[] = { .001, .0025, .005, .01, .025, .05, .1, .25, .5, 1, 2.5, 5, 10 };
+	const char* latencyBucketLabels[] = { "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25", "0.5", "1", "2.5", "5", "10", "+Inf" };
+
+	std::atomic<uint64> nextMetricsId { 1 };
+
+	String getOpcodeName(int opcode)
+	{
+		switch (opcode)
+		{
+		case 0: return "continuation";
+		case 1: return "text";
+		case 2: return "binary";
+		case 8: return "close";
+		case 9: return "ping";
+		case 10: return "pong";
+		default: return String(opcode);
+		}
+	}
+
+	void writeHeader(String& out, const String& name, const String& help, const String& type)
+	{
+		out << "# HELP " << name << " " << help << "\n";
+		out << "# TYPE " << name << " " << type << "\n";
+	}
+}
+
+ServerMetrics::ServerMetrics() :
+	id(nextMetricsId++)
+{
+}
+
+ServerMetrics::~ServerMetrics()
+{
+}
+
+void ServerMetrics::increment(Counter counter, uint64 amount)
+{
+	getCell().counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void ServerMetrics::addMessage(Direction direction, int opcode, size_t numBytes)
+{
+	Cell& cell = getCell();
+	cell.messages[direction][opcode & 0x0f].fetch_add(1, std::memory_order_relaxed);
+	cell.bytes[direction][opcode & 0x0f].fetch_add(numBytes, std::memory_order_relaxed);
+}
+
+void ServerMetrics::addHTTPRequest(int status, double durationSeconds)
+{
+	Cell& cell = getCell();
+	if (status >= 0 && status < maxStatus) cell.httpRequests[status].fetch_add(1, std::memory_order_relaxed);
+
+	int bucket = 0;
+	while (bucket < numLatencyBuckets && durationSeconds > latencyBucketBounds[bucket]) bucket++;
+	cell.latencyBuckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	cell.latencySumMicros.fetch_add((uint64)jmax(0.0, durationSeconds * 1e6), std::memory_order_relaxed);
+}
+
+void ServerMetrics::addGauge(const String& name, const String& help, std::function<double()> getValue)
+{
+	ScopedLock sl(gaugesLock);
+	gauges.push_back({ name, help, getValue });
+}
+
+uint64 ServerMetrics::getCounter(Counter counter) const
+{
+	return sum([counter](const Cell& c) -> const std::atomic<uint64>& { return c.counters[counter]; });
+}
+
+String ServerMetrics::toPrometheusText() const
+{
+	String out;
+
+	const char* counterNames[NumCounters][2] = {
+		{ "simpleweb_connections_accepted_total", "Connections accepted by the HTTP server." },
+		{ "simpleweb_tls_handshakes_total", "Successful TLS handshakes." },
+		{ "simpleweb_tls_handshake_errors_total", "Failed TLS handshakes." },
+		{ "simpleweb_tls_resumed_handshakes_total", "Successful TLS handshakes that resumed a session instead of doing a full key exchange." },
+		{ "simpleweb_websocket_handshakes_total", "WebSocket connections opened." },
+		{ "simpleweb_websocket_dropped_frames_total", "WebSocket frames that could not be sent." }
+	};
+
+	for (int i = 0; i < NumCounters; i++)
+	{
+		writeHeader(out, counterNames[i][0], counterNames[i][1], "counter");
+		out << counterNames[i][0] << " " << String(getCounter((Counter)i)) << "\n";
+	}
+
+	const char* directions[2] = { "in", "out" };
+
+	writeHeader(out, "simpleweb_websocket_messages_total", "WebSocket messages by direction and opcode.", "counter");
+	for (int d = 0; d < 2; d++)
+	{
+		for (int op = 0; op < numOpcodes; op++)
+		{
+			uint64 v = sum([d, op](const Cell& c) -> const std::atomic<uint64>& { return c.messages[d][op]; });
+			if (v > 0) out << "simpleweb_websocket_messages_total{direction=\"" << directions[d] << "\",opcode=\"" << getOpcodeName(op) << "\"} " << String(v) << "\n";
+		}
+	}
+
+	writeHeader(out, "simpleweb_websocket_bytes_total", "WebSocket payload bytes by direction and opcode.", "counter");
+	for (int d = 0; d < 2; d++)
+	{
+		for (int op = 0; op < numOpcodes; op++)
+		{
+			uint64 v = sum([d, op](const Cell& c) -> const std::atomic<uint64>& { return c.bytes[d][op]; });
+			if (v > 0) out << "simpleweb_websocket_bytes_total{direction=\"" << directions[d] << "\",opcode=\"" << getOpcodeName(op) << "\"} " << String(v) << "\n";
+		}
+	}
+
+	writeHeader(out, "simpleweb_http_requests_total", "HTTP requests by response status.", "counter");
+	for (int status = 0; status < maxStatus; status++)
+	{
+		uint64 v = sum([status](const Cell& c) -> const std::atomic<uint64>& { return c.httpRequests[status]; });
+		if (v > 0) out << "simpleweb_http_requests_total{code=\"" << String(status) << "\"} " << String(v) << "\n";
+	}
+
+	writeHeader(out, "simpleweb_http_request_duration_seconds", "Time from the end of the request header to the end of the response.", "histogram");
+	uint64 cumulated = 0;
+	for (int b = 0; b <= numLatencyBuckets; b++)
+	{
+		cumulated += sum([b](const Cell& c) -> const std::atomic<uint64>& { return c.latencyBuckets[b]; });
+		out << "simpleweb_http_request_duration_seconds_bucket{le=\"" << latencyBucketLabels[b] << "\"} " << String(cumulated) << "\n";
+	}
+	uint64 sumMicros = sum([](const Cell& c) -> const std::atomic<uint64>& { return c.latencySumMicros; });
+	out << "simpleweb_http_request_duration_seconds_sum " << String(sumMicros / 1e6, 6) << "\n";
+	out << "simpleweb_http_request_duration_seconds_count " << String(cumulated) << "\n";
+
+	ScopedLock sl(gaugesLock);
+	for (auto& g : gauges)
+	{
+		writeHeader(out, g.name, g.help, "gauge");
+		out << g.name << " " << String(g.getValue()) << "\n";
+	}
+
+	return out;
+}
+
+ServerMetrics::Cell& ServerMetrics::getCell()
+{
+	// Most threads only ever update one ServerMetrics, so remember the last one before looking up the map
+	thread_local uint64 lastId = 0;
+	thread_local Cell* lastCell = nullptr;
+	if (lastId == id) return *lastCell;
+
+	thread_local std::unordered_map<uint64, std::shared_ptr<Cell>> threadCells;
+	std::shared_ptr<Cell>& cell = threadCells[id];
+	if (cell == nullptr)
+	{
+		cell = std::make_shared<Cell>();
+		ScopedLock sl(cellsLock);
+		cells.push_back(cell);
+	}
+
+	lastId = id;
+	lastCell = cell.get();
+	return *cell;
+}
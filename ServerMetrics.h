@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+	ServerMetrics.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief Counters, gauges and a latency histogram for a server, rendered in the Prometheus text format.
+/// Every thread updates its own cell with relaxed atomic increments, so the io threads never contend on a shared
+/// cache line. The cells are only summed when the metrics are rendered.
+class ServerMetrics
+{
+public:
+	ServerMetrics();
+	~ServerMetrics();
+
+	enum Counter
+	{
+		ConnectionsAccepted,
+		TLSHandshakes,
+		TLSHandshakeErrors,
+		TLSResumedHandshakes, // Also counted in TLSHandshakes
+		WebSocketHandshakes,
+		DroppedFrames,
+		NumCounters
+	};
+
+	enum Direction { Incoming, Outgoing };
+
+	void increment(Counter counter, juce::uint64 amount = 1);
+
+	/// @brief opcode is the WebSocket opcode, the low 4 bits of fin_rsv_opcode.
+	void addMessage(Direction direction, int opcode, size_t numBytes);
+
+	/// @brief Records a completed HTTP request with its status and the time from the end of its header to the end of its response.
+	void addHTTPRequest(int status, double durationSeconds);
+
+	/// @brief Gauges are sampled with getValue each time the metrics are rendered.
+	void addGauge(const juce::String& name, const juce::String& help, std::function<double()> getValue);
+
+	juce::uint64 getCounter(Counter counter) const;
+	juce::String toPrometheusText() const;
+
+private:
+	static const int numOpcodes = 16;
+	static const int maxStatus = 600;
+	static const int numLatencyBuckets = 13; // Bounds in latencyBucketBounds, plus +Inf
+
+	struct Cell
+	{
+		std::atomic<juce::uint64> counters[NumCounters] {};
+		std::atomic<juce::uint64> messages[2][numOpcodes] {};
+		std::atomic<juce::uint64> bytes[2][numOpcodes] {};
+		std::atomic<juce::uint64> httpRequests[maxStatus] {};
+		std::atomic<juce::uint64> latencyBuckets[numLatencyBuckets + 1] {};
+		std::atomic<juce::uint64> latencySumMicros {};
+	};
+
+	struct Gauge
+	{
+		juce::String name;
+		juce::String help;
+		std::function<double()> getValue;
+	};
+
+	Cell& getCell();
+
+	template <typename Getter>
+	juce::uint64 sum(Getter getter) const
+	{
+		juce::ScopedLock sl(cellsLock);
+		juce::uint64 total = 0;
+		for (auto& cell : cells) total += getter(*cell).load(std::memory_order_relaxed);
+		return total;
+	}
+
+	const juce::uint64 id; // Unique for the process lifetime, so that thread cells never outlive the instance they're cached for
+	juce::CriticalSection cellsLock;
+	std::vector<std::shared_ptr<Cell>> cells;
+
+	juce::CriticalSection gaugesLock;
+	std::vector<Gauge> gauges;
+};
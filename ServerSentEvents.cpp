@@ -0,0 +1,154 @@
+/*
+  ==============================================================================
+
+	ServerSentEvents.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+ServerSentEvents::ServerSentEvents(int replaySize, int heartbeatMs, int maxPendingEvents) :
+	replaySize(replaySize),
+	heartbeatMs(heartbeatMs),
+	maxPendingEvents(maxPendingEvents),
+	lastId(0),
+	heartbeat(std::make_shared<const std::string>(":\n\n"))
+{
+}
+
+ServerSentEvents::~ServerSentEvents()
+{
+	stop();
+}
+
+int64 ServerSentEvents::broadcast(const String& data, const String& eventType)
+{
+	ScopedLock sl(lock);
+
+	int64 id = ++lastId;
+
+	std::string encoded = "id: " + std::to_string(id) + "\n";
+	if (eventType.isNotEmpty()) encoded += "event: " + eventType.toStdString() + "\n";
+
+	StringArray lines = StringArray::fromLines(data);
+	if (lines.isEmpty()) lines.add(String());
+	for (auto& line : lines) encoded += "data: " + line.toStdString() + "\n";
+	encoded += "\n";
+
+	std::shared_ptr<const std::string> buffer = std::make_shared<const std::string>(std::move(encoded));
+
+	if (replaySize > 0)
+	{
+		replay.push_back({ id, buffer });
+		while ((int)replay.size() > replaySize) replay.pop_front();
+	}
+
+	std::vector<std::shared_ptr<Subscriber>> slowSubscribers;
+	for (auto& subscriber : subscribers)
+	{
+		if (subscriber->getNumPendingSends() >= (size_t)maxPendingEvents) slowSubscribers.push_back(subscriber);
+		else sendToSubscriber(subscriber, buffer);
+	}
+
+	for (auto& subscriber : slowSubscribers)
+	{
+		DBG("Dropping slow event stream subscriber");
+		removeSubscriber(subscriber.get());
+	}
+
+	return id;
+}
+
+void ServerSentEvents::startHeartbeat(std::shared_ptr<asio::io_service> service)
+{
+	ScopedLock sl(lock);
+	if (heartbeatMs <= 0 || ioService != nullptr || service == nullptr) return;
+
+	ioService = service;
+	scheduleHeartbeat();
+}
+
+void ServerSentEvents::stop()
+{
+	ScopedLock sl(lock);
+
+	if (heartbeatTimer != nullptr)
+	{
+		SimpleWeb::error_code ec;
+		heartbeatTimer->cancel(ec);
+		heartbeatTimer.reset();
+	}
+	ioService.reset();
+
+	subscribers.clear(); // Releasing the responses closes the connections
+}
+
+int ServerSentEvents::getNumSubscribers() const
+{
+	ScopedLock sl(lock);
+	return (int)subscribers.size();
+}
+
+void ServerSentEvents::addSubscriber(std::shared_ptr<Subscriber> subscriber, int64 lastEventId)
+{
+	ScopedLock sl(lock);
+
+	subscribers.push_back(subscriber);
+
+	// The header is sent along with the first buffer, or alone if there is nothing to replay
+	bool sentSomething = false;
+	if (lastEventId >= 0)
+	{
+		for (auto& e : replay)
+		{
+			if (e.id <= lastEventId) continue;
+			sendToSubscriber(subscriber, e.buffer);
+			sentSomething = true;
+		}
+	}
+
+	if (!sentSomething) sendToSubscriber(subscriber, std::make_shared<const std::string>());
+}
+
+void ServerSentEvents::sendToSubscriber(std::shared_ptr<Subscriber> subscriber, std::shared_ptr<const std::string> buffer)
+{
+	std::weak_ptr<ServerSentEvents> weak = shared_from_this();
+	Subscriber* target = subscriber.get();
+	subscriber->send(buffer, [weak, target](const SimpleWeb::error_code& ec)
+		{
+			if (!ec) return;
+			if (std::shared_ptr<ServerSentEvents> self = weak.lock()) self->removeSubscriber(target);
+		});
+}
+
+void ServerSentEvents::removeSubscriber(Subscriber* subscriber)
+{
+	ScopedLock sl(lock);
+	subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [subscriber](const std::shared_ptr<Subscriber>& s) { return s.get() == subscriber; }), subscribers.end());
+}
+
+void ServerSentEvents::scheduleHeartbeat()
+{
+	std::weak_ptr<ServerSentEvents> weak = shared_from_this();
+	heartbeatTimer.reset(new asio::steady_timer(*ioService, std::chrono::milliseconds(heartbeatMs)));
+	heartbeatTimer->async_wait([weak](const SimpleWeb::error_code& ec)
+		{
+			if (ec) return;
+			std::shared_ptr<ServerSentEvents> self = weak.lock();
+			if (self == nullptr) return;
+
+			ScopedLock sl(self->lock);
+			if (self->ioService == nullptr) return; // Stopped
+
+			for (auto& subscriber : self->subscribers)
+			{
+				if (subscriber->getNumPendingSends() == 0) self->sendToSubscriber(subscriber, self->heartbeat);
+			}
+
+			self->scheduleHeartbeat();
+		});
+}
@@ -0,0 +1,99 @@
+/*
+  ==============================================================================
+
+	ServerSentEvents.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief A server-sent events (text/event-stream) channel.
+/// Each event is encoded once into a buffer shared by all subscribers. The last events are kept so that clients
+/// reconnecting with a Last-Event-ID header get what they missed, and a comment line is sent as heartbeat to keep
+/// idle connections and proxies alive.
+class ServerSentEvents :
+	public std::enable_shared_from_this<ServerSentEvents>
+{
+public:
+	ServerSentEvents(int replaySize = 256, int heartbeatMs = 15000, int maxPendingEvents = 64);
+	~ServerSentEvents();
+
+	int replaySize; // Number of events kept for Last-Event-ID replay
+	int heartbeatMs; // 0 to disable heartbeats
+	int maxPendingEvents; // Subscribers that fall further behind than this are dropped
+
+	/// @brief Keeps the response open as an event stream and sends the events that came after the request's Last-Event-ID.
+	template <class ResponseType, class RequestType>
+	void subscribe(std::shared_ptr<ResponseType> response, std::shared_ptr<RequestType> request)
+	{
+		juce::int64 lastEventId = -1;
+		auto it = request->header.find("Last-Event-ID");
+		if (it != request->header.end()) lastEventId = juce::String(it->second).getLargeIntValue();
+
+		SimpleWeb::CaseInsensitiveMultimap header;
+		header.emplace("Content-Type", "text/event-stream");
+		header.emplace("Cache-Control", "no-cache");
+		header.emplace("Access-Control-Allow-Origin", "*");
+
+		response->close_connection_after_response = true; // No Content-Length, the stream ends with the connection
+		response->cancel_timeout(); // Heartbeats keep the stream alive, and a dead client shows when they can't be sent
+		response->write(SimpleWeb::StatusCode::success_ok, header);
+
+		addSubscriber(std::make_shared<ResponseSubscriber<ResponseType>>(response), lastEventId);
+	}
+
+	/// @brief Sends an event to all subscribers, and returns the id it was given.
+	juce::int64 broadcast(const juce::String& data, const juce::String& eventType = juce::String());
+
+	/// @brief Starts sending heartbeats on the given io_service, does nothing if they are already running.
+	void startHeartbeat(std::shared_ptr<asio::io_service> ioService);
+
+	/// @brief Stops the heartbeats and closes all the event streams.
+	void stop();
+
+	int getNumSubscribers() const;
+
+private:
+	class Subscriber
+	{
+	public:
+		virtual ~Subscriber() {}
+		virtual void send(std::shared_ptr<const std::string> buffer, std::function<void(const SimpleWeb::error_code&)> callback) = 0;
+		virtual size_t getNumPendingSends() = 0;
+	};
+
+	template <class ResponseType>
+	class ResponseSubscriber :
+		public Subscriber
+	{
+	public:
+		ResponseSubscriber(std::shared_ptr<ResponseType> response) : response(response) {}
+
+		void send(std::shared_ptr<const std::string> buffer, std::function<void(const SimpleWeb::error_code&)> callback) override { response->send_buffer(buffer, callback); }
+		size_t getNumPendingSends() override { return response->send_queue_size(); }
+
+		std::shared_ptr<ResponseType> response;
+	};
+
+	struct Event
+	{
+		juce::int64 id;
+		std::shared_ptr<const std::string> buffer;
+	};
+
+	void addSubscriber(std::shared_ptr<Subscriber> subscriber, juce::int64 lastEventId);
+	void sendToSubscriber(std::shared_ptr<Subscriber> subscriber, std::shared_ptr<const std::string> buffer);
+	void removeSubscriber(Subscriber* subscriber);
+	void scheduleHeartbeat();
+
+	juce::CriticalSection lock;
+	juce::int64 lastId;
+	std::deque<Event> replay;
+	std::vector<std::shared_ptr<Subscriber>> subscribers;
+
+	std::shared_ptr<asio::io_service> ioService; // Keeps the heartbeat timer's io_service alive
+	std::unique_ptr<asio::steady_timer> heartbeatTimer;
+	std::shared_ptr<const std::string> heartbeat;
+};
@@ -3,7 +3,13 @@ using namespace juce;
 SimpleWebSocketClientBase::SimpleWebSocketClientBase() :
 	Thread("Web socket client"),
 	isConnected(false),
-	isClosing(false)
+	isClosing(false),
+	convertMessages(true),
+	autoReconnect(false),
+	reconnectMinDelayMs(500),
+	reconnectMaxDelayMs(30000),
+	maxBufferedMessages(0),
+	bufferDropPolicy(DropOldest)
 {
 }
 
@@ -15,7 +21,21 @@ SimpleWebSocketClientBase::~SimpleWebSocketClientBase()
 void SimpleWebSocketClientBase::start(const String& _serverPath)
 {
 	this->serverPath = _serverPath;
-	startThread();
+
+	// With a shared runtime, initWS only starts connecting and returns
+	if (ioRuntime != nullptr) run();
+	else startThread();
+}
+
+void SimpleWebSocketClientBase::send(const String& message)
+{
+	std::string s = message.toStdString();
+	sendOrBuffer(s.data(), s.size(), 129);
+}
+
+void SimpleWebSocketClientBase::send(const char* data, int numData)
+{
+	sendOrBuffer(data, (size_t)numData, 130); // 130 = binary
 }
 
 void SimpleWebSocketClientBase::send(const MemoryBlock& data)
@@ -23,11 +43,54 @@ void SimpleWebSocketClientBase::send(const MemoryBlock& data)
 	send((const char*)data.getData(), (int)data.getSize());
 }
 
+void SimpleWebSocketClientBase::sendMessagePack(const var& value)
+{
+	// The payload is masked into the frame anyway, which takes a copy, so it is encoded to a block first
+	MemoryBlock data = MessagePack::toMemoryBlock(value);
+	sendOrBuffer((const char*)data.getData(), data.getSize(), 130); // 130 = binary
+}
+
+int SimpleWebSocketClientBase::getNumBufferedMessages() const
+{
+	ScopedLock lock(outboxLock);
+	return (int)outbox.size();
+}
+
+void SimpleWebSocketClientBase::sendOrBuffer(const char* data, size_t numData, unsigned char finRsvOpcode)
+{
+	ScopedLock lock(outboxLock);
+	if (isConnected)
+	{
+		sendMessage(data, numData, finRsvOpcode);
+		return;
+	}
+
+	if (maxBufferedMessages <= 0 || (bufferDropPolicy == DropNewest && (int)outbox.size() >= maxBufferedMessages))
+	{
+		++numDroppedMessages;
+		return;
+	}
+
+	while ((int)outbox.size() >= maxBufferedMessages)
+	{
+		outbox.pop_front();
+		++numDroppedMessages;
+	}
+
+	outbox.push_back({ std::string(data, numData), finRsvOpcode });
+}
+
 void SimpleWebSocketClientBase::stop()
 {
 	this->isClosing = true;
 	
 	stopInternal();
+	if (ioRuntime != nullptr) this->isConnected = false; // There is no thread to end and reset it
+
+	{
+		ScopedLock lock(outboxLock);
+		outbox.clear();
+	}
 
 	if (Thread::getCurrentThreadId() != this->getThreadId()) stopThread(1000);
 	this->isClosing = false;
@@ -40,28 +103,57 @@ void SimpleWebSocketClientBase::run()
 
 	initWS();
 
+	if (ioRuntime != nullptr) return;
+
 	//end thread
 	this->isConnected = false;
 }
 
 void SimpleWebSocketClientBase::handleNewConnectionCallback()
 {
-	this->isConnected = true;
+	{
+		// Sent before the listeners are told, so that the buffered messages go out before any they send in connectionOpened
+		ScopedLock lock(outboxLock);
+		this->isConnected = true;
+		for (auto& m : outbox) sendMessage(m.data.data(), m.data.size(), m.finRsvOpcode);
+		outbox.clear();
+	}
+
 	this->webSocketListeners.call(&Listener::connectionOpened);
 }
 
+void SimpleWebSocketClientBase::dispatchMessage(const WebSocketPayload& payload)
+{
+	webSocketListeners.call(&Listener::payloadReceived, payload);
+	if (!convertMessages) return;
+
+	if (payload.isText()) webSocketListeners.call(&Listener::messageReceived, payload.toString());
+	else webSocketListeners.call(&Listener::dataReceived, payload.toMemoryBlock());
+}
+
 void SimpleWebSocketClientBase::handleConnectionClosedCallback(int status, const String& reason)
 {
-	this->isConnected = false;
+	{
+		ScopedLock lock(outboxLock);
+		this->isConnected = false;
+	}
 	this->webSocketListeners.call(&Listener::connectionClosed, status, reason);
 }
 
 void SimpleWebSocketClientBase::handleErrorCallback(const String& message)
 {
-	this->isConnected = false;
+	{
+		ScopedLock lock(outboxLock);
+		this->isConnected = false;
+	}
 	if (!this->isClosing) this->webSocketListeners.call(&Listener::connectionError, message);
 }
 
+void SimpleWebSocketClientBase::handleReconnectCallback(int attempt, long delayMs)
+{
+	this->webSocketListeners.call(&Listener::connectionReconnecting, attempt, (int)delayMs);
+}
+
 
 // SIMPLE WS
 
@@ -77,23 +169,24 @@ SimpleWebSocketClient::~SimpleWebSocketClient()
 	stop();
 }
 
-void SimpleWebSocketClient::send(const String& message)
+void SimpleWebSocketClient::sendMessage(const char* data, size_t numData, unsigned char finRsvOpcode)
 {
-	if (this->connection != nullptr) this->connection->send(message.toStdString());
-}
-
-void SimpleWebSocketClient::send(const char* data, int numData)
-{
-	std::shared_ptr<WsClient::OutMessage> out_message = std::make_shared<WsClient::OutMessage>();
-	out_message->write(data, numData);
-	if (this->connection != nullptr) this->connection->send(out_message, nullptr, 130);
+	std::shared_ptr<WsClient::OutMessage> out_message = std::make_shared<WsClient::OutMessage>(numData);
+	out_message->write(data, (std::streamsize)numData);
+	if (this->connection != nullptr) this->connection->send(out_message, nullptr, finRsvOpcode);
 }
 
 void SimpleWebSocketClient::stopInternal()
 {
 	if (this->connection != nullptr) this->connection->send_close(1000, "Time to split my friend");
-	if (ws != nullptr) ws->stop();
+	if (ws != nullptr)
+	{
+		ws->stop();
 
+		// The shared io_service keeps running, so ws is destroyed to keep its handlers from calling back after stop().
+		// From a handler this would wait for itself, so it is then left to the next initWS or the destructor.
+		if (ioRuntime != nullptr && !ioRuntime->isIOThread()) ws.reset();
+	}
 }
 
 void SimpleWebSocketClient::initWS()
@@ -102,22 +195,25 @@ void SimpleWebSocketClient::initWS()
 
 	ws->config.timeout_request = 1000;
 	ws->config.timeout_idle = 1000;
+	ws->config.reconnect = autoReconnect;
+	ws->config.reconnect_delay_min = reconnectMinDelayMs;
+	ws->config.reconnect_delay_max = reconnectMaxDelayMs;
+	if (ioRuntime != nullptr) ws->io_service = ioRuntime->getIOService();
 
 	ws->on_message = std::bind(&SimpleWebSocketClient::onMessageCallback, this, std::placeholders::_1, std::placeholders::_2);
 	ws->on_error = std::bind(&SimpleWebSocketClient::onErrorCallback, this, std::placeholders::_1, std::placeholders::_2);
 	ws->on_open = std::bind(&SimpleWebSocketClient::onNewConnectionCallback, this, std::placeholders::_1);
 	ws->on_close = std::bind(&SimpleWebSocketClient::onConnectionCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+	ws->on_reconnect = std::bind(&SimpleWebSocketClient::handleReconnectCallback, this, std::placeholders::_1, std::placeholders::_2);
 
 	ws->start();
 }
 
 void SimpleWebSocketClient::onMessageCallback(std::shared_ptr<WsClient::Connection> connection, std::shared_ptr<WsClient::InMessage> in_message)
 {
-	if (in_message->fin_rsv_opcode == 129) webSocketListeners.call(&Listener::messageReceived, String(in_message->string()));
-	else if (in_message->fin_rsv_opcode == 130)
+	if (in_message->fin_rsv_opcode == 129 || in_message->fin_rsv_opcode == 130)
 	{
-		MemoryBlock b(in_message->string().c_str(), in_message->size());
-		webSocketListeners.call(&Listener::dataReceived, b);
+		dispatchMessage(WebSocketPayload(in_message, in_message->data(), in_message->size(), in_message->fin_rsv_opcode & 0x0f));
 	}
 	else if (in_message->fin_rsv_opcode == 136)
 	{
@@ -130,7 +226,8 @@ void SimpleWebSocketClient::onNewConnectionCallback(std::shared_ptr<WsClient::Co
 	this->connection = _connection;
 
 	asio::ip::tcp::socket::keep_alive kaOption(true);
-	this->connection->get_socket()->set_option(kaOption);
+	SimpleWeb::error_code ec; // Fails on connections over a Unix domain socket, which don't need it
+	this->connection->get_socket()->set_option(kaOption, ec);
 
 	handleNewConnectionCallback();
 }
@@ -160,44 +257,75 @@ SecureWebSocketClient::~SecureWebSocketClient()
 
 }
 
-void SecureWebSocketClient::send(const String& message)
+void SecureWebSocketClient::sendMessage(const char* data, size_t numData, unsigned char finRsvOpcode)
 {
-	if (this->connection != nullptr) this->connection->send(message.toStdString());
+	std::shared_ptr<WssClient::OutMessage> out_message = std::make_shared<WssClient::OutMessage>(numData);
+	out_message->write(data, (std::streamsize)numData);
+	if (this->connection != nullptr) this->connection->send(out_message, nullptr, finRsvOpcode);
 }
 
-void SecureWebSocketClient::send(const char* data, int numData)
+void SecureWebSocketClient::stopInternal()
 {
-	std::shared_ptr<WssClient::OutMessage> out_message = std::make_shared<WssClient::OutMessage>();
-	out_message->write(data, numData);
-	if (this->connection != nullptr) this->connection->send(out_message, nullptr, 130);
+	if (this->connection != nullptr) this->connection->send_close(1000, "Time to split my friend");
+	if (ws != nullptr)
+	{
+		ws->stop();
+
+		// The shared io_service keeps running, so ws is destroyed to keep its handlers from calling back after stop().
+		// From a handler this would wait for itself, so it is then left to the next initWS or the destructor.
+		if (ioRuntime != nullptr && !ioRuntime->isIOThread()) ws.reset();
+	}
 }
 
-void SecureWebSocketClient::stopInternal()
+std::shared_ptr<asio::ssl::context> SecureWebSocketClient::getSharedContext()
 {
-	if (this->connection != nullptr) this->connection->send_close(1000, "Time to split my friend");
-	if (ws != nullptr) ws->stop();
+	static std::shared_ptr<asio::ssl::context> context = WssClient::make_context(false);
+	return context;
+}
 
+void SecureWebSocketClient::prewarm(const String& _serverPath)
+{
+	if (ioRuntime == nullptr) return; // The client's own thread only runs once started
+
+	this->serverPath = _serverPath;
+	createWS();
+	prewarmedPath = _serverPath;
+	ws->prewarm();
 }
 
 void SecureWebSocketClient::initWS()
 {
-	ws.reset(new WssClient(serverPath.toStdString(), false));
+	// A client prewarmed for this server already has its connection under way
+	if (ws == nullptr || prewarmedPath != serverPath) createWS();
+	prewarmedPath = String();
+
+	ws->start();
+}
+
+void SecureWebSocketClient::createWS()
+{
+	ws.reset(new WssClient(serverPath.toStdString(), getSharedContext()));
 
 	ws->config.timeout_request = 1000;
 	ws->config.timeout_idle = 1000;
+	ws->config.reconnect = autoReconnect;
+	ws->config.reconnect_delay_min = reconnectMinDelayMs;
+	ws->config.reconnect_delay_max = reconnectMaxDelayMs;
+	if (ioRuntime != nullptr) ws->io_service = ioRuntime->getIOService();
 
 	ws->on_message = std::bind(&SecureWebSocketClient::onMessageCallback, this, std::placeholders::_1, std::placeholders::_2);
 	ws->on_error = std::bind(&SecureWebSocketClient::onErrorCallback, this, std::placeholders::_1, std::placeholders::_2);
 	ws->on_open = std::bind(&SecureWebSocketClient::onNewConnectionCallback, this, std::placeholders::_1);
 	ws->on_close = std::bind(&SecureWebSocketClient::onConnectionCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
-
-	ws->start();
+	ws->on_reconnect = std::bind(&SecureWebSocketClient::handleReconnectCallback, this, std::placeholders::_1, std::placeholders::_2);
 }
 
 void SecureWebSocketClient::onMessageCallback(std::shared_ptr<WssClient::Connection> connection, std::shared_ptr<WssClient::InMessage> in_message)
 {
-	if (in_message->fin_rsv_opcode == 129) webSocketListeners.call(&Listener::messageReceived, String(in_message->string()));
-	else if (in_message->fin_rsv_opcode == 130) webSocketListeners.call(&Listener::dataReceived, in_message->binary);
+	if (in_message->fin_rsv_opcode == 129 || in_message->fin_rsv_opcode == 130)
+	{
+		dispatchMessage(WebSocketPayload(in_message, in_message->data(), in_message->size(), in_message->fin_rsv_opcode & 0x0f));
+	}
 	else if (in_message->fin_rsv_opcode == 136)
 	{
 		DBG("Connection ended");
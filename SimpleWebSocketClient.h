@@ -28,13 +28,31 @@ public:
 	bool isConnected;
 	bool isClosing;
 
-	virtual void start(const juce::String& _serverPath);
+	std::shared_ptr<IORuntime> ioRuntime; // Shared io threads to run on, e.g. IORuntime::getShared(). Set before start(), null to run on a thread of its own
+	bool convertMessages; // Also copy each message into a String or MemoryBlock for messageReceived and dataReceived. Turn off when all the listeners use payloadReceived
+
+	bool autoReconnect; // Connect again when the connection is lost, with a jittered exponential backoff, see SimpleWeb Config::reconnect
+	int reconnectMinDelayMs;
+	int reconnectMaxDelayMs;
 
-	virtual void send(const juce::String& message) {}
-	virtual void send(const char* data, int numData) {}
+	enum BufferDropPolicy { DropOldest, DropNewest };
+	int maxBufferedMessages; // Messages sent while disconnected are kept up to this number and sent once connected, 0 to drop them
+	BufferDropPolicy bufferDropPolicy; // Which message is dropped when the buffer is full
 
+	/// @brief Connects to _serverPath, host[:port]/path, or unix:<socket path>[:<path>] for a server on the same host listening on a Unix domain socket.
+	virtual void start(const juce::String& _serverPath);
+
+	/// @brief Sent right away while connected, else buffered, see maxBufferedMessages.
+	virtual void send(const juce::String& message);
+	virtual void send(const char* data, int numData);
 	void send(const juce::MemoryBlock& data);
 
+	/// @brief Sends value as a binary MessagePack message.
+	void sendMessagePack(const juce::var& value);
+
+	int getNumBufferedMessages() const;
+	juce::int64 getNumDroppedMessages() const { return numDroppedMessages.get(); }
+
 	void stop();
 	virtual void stopInternal() {}
 	virtual void run();
@@ -45,6 +63,7 @@ public:
 	void handleNewConnectionCallback();
 	void handleConnectionClosedCallback(int status, const juce::String& reason);
 	void handleErrorCallback(const juce::String& message);
+	void handleReconnectCallback(int attempt, long delayMs);
 
 	class Listener
 	{
@@ -53,13 +72,35 @@ public:
 		virtual void connectionOpened() {}
 		virtual void messageReceived(const juce::String& message) {}
 		virtual void dataReceived(const juce::MemoryBlock& data) {}
+		virtual void payloadReceived(const WebSocketPayload& payload) {} // Text and binary messages, without copy
 		virtual void connectionClosed(int status, const juce::String& reason) {}
 		virtual void connectionError(const juce::String& message) {}
+		virtual void connectionReconnecting(int attempt, int delayMs) {}
 	};
 
 	juce::ListenerList<Listener> webSocketListeners;
 	void addWebSocketListener(Listener* newListener) { webSocketListeners.add(newListener); }
 	void removeWebSocketListener(Listener* listener) { webSocketListeners.remove(listener); }
+
+protected:
+	/// @brief Calls the listeners with a received text or binary message.
+	void dispatchMessage(const WebSocketPayload& payload);
+
+	/// @brief Sends on the current connection. Called with outboxLock held, and only while connected.
+	virtual void sendMessage(const char* data, size_t numData, unsigned char finRsvOpcode) {}
+
+private:
+	struct BufferedMessage
+	{
+		std::string data;
+		unsigned char finRsvOpcode;
+	};
+
+	void sendOrBuffer(const char* data, size_t numData, unsigned char finRsvOpcode);
+
+	juce::CriticalSection outboxLock;
+	std::deque<BufferedMessage> outbox;
+	juce::Atomic<juce::int64> numDroppedMessages;
 };
 
 class SimpleWebSocketClient :
@@ -74,8 +115,6 @@ public:
 	SimpleWebSocketClient();
 	~SimpleWebSocketClient();
 
-	void send(const juce::String& message) override;
-	void send(const char* data, int numData) override;
 	void stopInternal() override;
 
 	void initWS() override;
@@ -84,6 +123,9 @@ public:
 	void onNewConnectionCallback(std::shared_ptr<WsClient::Connection> _connection);
 	void onConnectionCloseCallback(std::shared_ptr<WsClient::Connection> /*_connection*/, int status, const std::string& reason);
 	void onErrorCallback(std::shared_ptr<WsClient::Connection> /*_connection*/, const SimpleWeb::error_code& ec);
+
+protected:
+	void sendMessage(const char* data, size_t numData, unsigned char finRsvOpcode) override;
 };
 
 #if SIMPLEWEB_SECURE_SUPPORTED
@@ -100,8 +142,10 @@ public:
 	SecureWebSocketClient();
 	~SecureWebSocketClient();
 
-	void send(const juce::String& message) override;
-	void send(const char* data, int numData) override;
+	/// @brief Connects to the server and completes the TLS handshake ahead of start(_serverPath), which then only sends the
+	/// WebSocket upgrade. Needs an ioRuntime, and does nothing without one.
+	void prewarm(const juce::String& _serverPath);
+
 	void stopInternal() override;
 
 	void initWS() override;
@@ -110,5 +154,16 @@ public:
 	void onNewConnectionCallback(std::shared_ptr<WssClient::Connection> _connection);
 	void onConnectionCloseCallback(std::shared_ptr<WssClient::Connection> /*_connection*/, int status, const std::string& reason);
 	void onErrorCallback(std::shared_ptr<WssClient::Connection> /*_connection*/, const SimpleWeb::error_code& ec);
+
+protected:
+	void sendMessage(const char* data, size_t numData, unsigned char finRsvOpcode) override;
+
+private:
+	/// @brief The context of all the secure clients, so that they share TLS sessions and reconnects resume them.
+	static std::shared_ptr<asio::ssl::context> getSharedContext();
+
+	void createWS();
+
+	juce::String prewarmedPath; // Server of the client made by prewarm(), kept by the next initWS
 };
 #endif
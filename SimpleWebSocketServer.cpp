@@ -13,10 +13,26 @@
 
 using namespace juce;
 
-SimpleWebSocketServerBase::SimpleWebSocketServerBase() : Thread("Web socket"), port(0), allowAddressReuse(false), isConnected(false) {}
+SimpleWebSocketServerBase::SimpleWebSocketServerBase() :
+	Thread("Web socket"),
+	port(0),
+	allowAddressReuse(false),
+	listenTCP(true),
+	isConnected(false),
+	numHandlerThreads(4),
+	maxPendingHandlerJobs(256),
+	handlerTimeoutMs(30000),
+	lowFootprint(false),
+	convertMessages(true)
+{
+	metrics.addGauge("simpleweb_websocket_connections", "Open WebSocket connections.", [this]() { return (double)getNumActiveConnections(); });
+	metrics.addGauge("simpleweb_websocket_send_queue_depth", "WebSocket messages waiting to be sent, over all connections.", [this]() { return (double)getSendQueueDepth(); });
+	metrics.addGauge("simpleweb_http_deferred_requests", "Deferred HTTP requests waiting for or running on a handler thread.", [this]() { return (double)numPendingHandlerJobs.get(); });
+}
 
 SimpleWebSocketServerBase::~SimpleWebSocketServerBase()
 {
+	stopHandlerJobs();
 	stopThread(2000);
 }
 
@@ -28,7 +44,10 @@ void SimpleWebSocketServerBase::start(int _port, const String& _wsSuffix, const
 	wsSuffix = _wsSuffix;
 	allowAddressReuse = allowAddrReuse;
 	isConnecting = true;
-	startThread();
+
+	// With a shared runtime, the server is set up on the calling thread and then only lives on the runtime's threads
+	if (ioRuntime != nullptr) run();
+	else startThread();
 }
 
 void SimpleWebSocketServerBase::send(const MemoryBlock& data)
@@ -42,6 +61,8 @@ void SimpleWebSocketServerBase::stop()
 	//	if (Thread::getCurrentThreadId() != this->getThreadId()) stopThread(500);
 	// #endif
 
+	stopHandlerJobs();
+	stopEventStreams();
 	stopInternal();
 	isConnecting = false;
 	isConnected = false;
@@ -51,6 +72,13 @@ void SimpleWebSocketServerBase::stop()
 	// #endif
 }
 
+#if SIMPLEWEB_ENABLE_TRACING
+bool SimpleWebSocketServerBase::writeTrace(const File& file)
+{
+	return file.replaceWithText(SimpleWeb::trace::ring().to_chrome_json());
+}
+#endif
+
 void SimpleWebSocketServerBase::closeConnection(const String& id, int code, const String& reason)
 {
 	closeConnectionInternal(id, code, reason);
@@ -64,219 +92,201 @@ void SimpleWebSocketServerBase::run()
 	initServer();
 }
 
-void SimpleWebSocketServerBase::addHTTPRequestHandler(RequestHandler* newHandler)
+std::shared_ptr<asio::io_service> SimpleWebSocketServerBase::createIOService() const
 {
-	handlers.add(newHandler);
+	if (ioRuntime != nullptr) return ioRuntime->getIOService();
+	return std::make_shared<asio::io_service>();
 }
 
-void SimpleWebSocketServerBase::removeHTTPRequestHandler(RequestHandler* handlerToRemove)
+bool SimpleWebSocketServerBase::isSharedIOService() const
 {
-	handlers.removeAllInstancesOf(handlerToRemove);
+	return ioRuntime != nullptr && ioService == ioRuntime->getIOService();
 }
 
-// SIMPLE
-
-SimpleWebSocketServer::SimpleWebSocketServer() {}
-
-SimpleWebSocketServer::~SimpleWebSocketServer()
+bool SimpleWebSocketServerBase::isIOThread() const
 {
-	stop();
+	if (ioRuntime != nullptr) return ioRuntime->isIOThread();
+	return Thread::getCurrentThreadId() == getThreadId();
 }
 
-void SimpleWebSocketServer::send(const String& message)
+void SimpleWebSocketServerBase::runIOService()
 {
-	HashMap<String, std::shared_ptr<WsServer::Connection>, DefaultHashFunctions, CriticalSection>::Iterator it(connectionMap);
-	while (it.next())
-	{
-		it.getValue()->send(message.toStdString());
-	}
+	// The runtime's threads are already running a shared io_service
+	if (ioService != nullptr && !isSharedIOService()) ioService->run();
 }
 
-void SimpleWebSocketServer::send(const char* data, int numData)
+void SimpleWebSocketServerBase::addHTTPRequestHandler(RequestHandler* newHandler)
 {
-	std::shared_ptr<WsServer::OutMessage> out_message = std::make_shared<WsServer::OutMessage>();
-	out_message->write(data, numData);
-	HashMap<String, std::shared_ptr<WsServer::Connection>, DefaultHashFunctions, CriticalSection>::Iterator it(connectionMap);
-	while (it.next())
-	{
-		it.getValue()->send(out_message, nullptr, 130); // 130 = binary
-	}
+	handlers.add(newHandler);
 }
 
-void SimpleWebSocketServer::sendTo(const String& message, const String& id)
+void SimpleWebSocketServerBase::removeHTTPRequestHandler(RequestHandler* handlerToRemove)
 {
-	if (connectionMap.contains(id))
-	{
-		connectionMap[id]->send(message.toStdString());
-	}
-	else
-	{
-		DBG("Websocket connection not found : " << id);
-	}
+	handlers.removeAllInstancesOf(handlerToRemove);
 }
 
-void SimpleWebSocketServer::sendTo(const MemoryBlock& data, const String& id)
+std::shared_ptr<DeferredHTTPResponse> SimpleWebSocketServerBase::deferResponse(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request)
 {
-	std::shared_ptr<WsServer::OutMessage> out_message = std::make_shared<WsServer::OutMessage>();
-	out_message->write((const char*) data.getData(), data.getSize());
-	if (connectionMap.contains(id))
-	{
-		connectionMap[id]->send(out_message, nullptr, 130); // 130 = binary
-	}
-	else
-	{
-		DBG("Websocket connection not found : " << id);
-	}
+	std::shared_ptr<DeferredHTTPResponse> deferred = std::make_shared<DeferredHTTPResponse>(response, request);
+	if (handlerTimeoutMs > 0 && ioService != nullptr) deferred->setDeadline(ioService, handlerTimeoutMs);
+	return deferred;
 }
 
-void SimpleWebSocketServer::sendExclude(const String& message, const StringArray excludeIds)
+bool SimpleWebSocketServerBase::deferHTTPRequest(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request, std::function<void(std::shared_ptr<DeferredHTTPResponse>)> job)
 {
-	HashMap<String, std::shared_ptr<WsServer::Connection>, DefaultHashFunctions, CriticalSection>::Iterator it(connectionMap);
-	while (it.next())
-	{
-		if (excludeIds.contains(it.getKey()))
+	std::shared_ptr<DeferredHTTPResponse> deferred = deferResponse(response, request);
+	bool added = addHandlerJob([deferred, job]
 		{
-			continue;
-		}
-		it.getValue()->send(message.toStdString());
-	}
+			if (deferred->isPending()) job(deferred);
+		});
+
+	if (!added) deferred->complete(SimpleWeb::StatusCode::server_error_service_unavailable, "Server busy");
+	return added;
 }
 
-void SimpleWebSocketServer::sendExclude(const MemoryBlock& data, const StringArray excludeIds)
+#if SIMPLEWEB_SECURE_SUPPORTED
+std::shared_ptr<DeferredHTTPSResponse> SimpleWebSocketServerBase::deferResponse(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request)
 {
-	std::shared_ptr<WsServer::OutMessage> out_message = std::make_shared<WsServer::OutMessage>();
-	out_message->write((const char*) data.getData(), data.getSize());
+	std::shared_ptr<DeferredHTTPSResponse> deferred = std::make_shared<DeferredHTTPSResponse>(response, request);
+	if (handlerTimeoutMs > 0 && ioService != nullptr) deferred->setDeadline(ioService, handlerTimeoutMs);
+	return deferred;
+}
 
-	HashMap<String, std::shared_ptr<WsServer::Connection>, DefaultHashFunctions, CriticalSection>::Iterator it(connectionMap);
-	while (it.next())
-	{
-		if (excludeIds.contains(it.getKey()))
+bool SimpleWebSocketServerBase::deferHTTPSRequest(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request, std::function<void(std::shared_ptr<DeferredHTTPSResponse>)> job)
+{
+	std::shared_ptr<DeferredHTTPSResponse> deferred = deferResponse(response, request);
+	bool added = addHandlerJob([deferred, job]
 		{
-			continue;
-		}
-		it.getValue()->send(out_message, nullptr, 130); // 130 = binary
-	}
+			if (deferred->isPending()) job(deferred);
+		});
+
+	if (!added) deferred->complete(SimpleWeb::StatusCode::server_error_service_unavailable, "Server busy");
+	return added;
 }
+#endif
 
-void SimpleWebSocketServer::stopInternal()
+std::shared_ptr<ServerSentEvents> SimpleWebSocketServerBase::addEventStream(const String& path)
 {
-	if (ioService != nullptr)
-	{
-		ioService->stop();
-	}
-	ScopedLock lock(serverLock);
-
-	if (ws != nullptr)
-	{
-		std::unordered_set<std::shared_ptr<WsServer::Connection>> connections = ws->get_connections();
-		for (auto& c : connections)
-		{
-			c->send_close(1000, "Server destroyed");
-		}
-		connectionMap.clear();
+	std::shared_ptr<ServerSentEvents> eventStream = std::make_shared<ServerSentEvents>();
+	eventStreams.set(path, eventStream);
+	return eventStream;
+}
 
-		ws->stop();
-	}
+void SimpleWebSocketServerBase::removeEventStream(const String& path)
+{
+	std::shared_ptr<ServerSentEvents> eventStream = eventStreams[path];
+	eventStreams.remove(path);
+	if (eventStream != nullptr) eventStream->stop();
+}
 
-	if (http != nullptr)
+void SimpleWebSocketServerBase::sendEvent(const String& path, const String& data, const String& eventType)
+{
+	std::shared_ptr<ServerSentEvents> eventStream = eventStreams[path];
+	if (eventStream == nullptr)
 	{
-		http->stop();
+		DBG("Event stream not found : " << path);
+		return;
 	}
 
-	ws.reset();
-	http.reset();
-	ioService.reset();
-
-	stopThread(1000);
+	eventStream->broadcast(data, eventType);
 }
 
-void SimpleWebSocketServer::closeConnectionInternal(const String& id, int code, const String& reason)
+void SimpleWebSocketServerBase::stopEventStreams()
 {
-	if (!connectionMap.contains(id))
+	HashMap<String, std::shared_ptr<ServerSentEvents>, DefaultHashFunctions, CriticalSection>::Iterator it(eventStreams);
+	while (it.next())
 	{
-		return;
+		it.getValue()->stop();
 	}
-	connectionMap[id]->send_close(code, reason.toStdString());
 }
 
-void SimpleWebSocketServer::initServer()
+std::function<void(const SimpleWeb::error_code&)> SimpleWebSocketServerBase::countOutgoingMessage(int opcode, size_t numBytes)
 {
-	ScopedLock lock(serverLock);
-
-	try
-	{
-		ioService = std::make_shared<asio::io_service>();
-		DBG("HTTP create");
-		http.reset(new HttpServer());
-		if (localAddress.isNotEmpty())
+	metrics.addMessage(ServerMetrics::Outgoing, opcode, numBytes);
+	return [this](const SimpleWeb::error_code& ec)
 		{
-			http->config.address = localAddress.toStdString();
-		}
-		http->config.port = port;
-		http->io_service = ioService;
+			if (ec) metrics.increment(ServerMetrics::DroppedFrames);
+		};
+}
 
-		std::function<void(std::shared_ptr<HttpServer::Response>, std::shared_ptr<HttpServer::Request>)> httpCallbackFunc = std::bind(&SimpleWebSocketServer::httpDefaultCallback, this, std::placeholders::_1, std::placeholders::_2);
-		http->default_resource["GET"] = httpCallbackFunc;
-		http->default_resource["POST"] = httpCallbackFunc;
-		http->default_resource["PUT"] = httpCallbackFunc;
-		http->default_resource["DELETE"] = httpCallbackFunc;
-		http->default_resource["PATCH"] = httpCallbackFunc;
-		http->on_upgrade = std::bind(&SimpleWebSocketServer::onHTTPUpgrade, this, std::placeholders::_1, std::placeholders::_2);
+void SimpleWebSocketServerBase::countPing()
+{
+	metrics.addMessage(ServerMetrics::Incoming, 9, 0);
+	metrics.addMessage(ServerMetrics::Outgoing, 10, 0); // Answered right away by the server
+}
 
-		// WebSocket init
-		DBG("WS create");
-		ws.reset(new WsServer());
-		auto& wsEndpoint = ws->endpoint[("^" + wsSuffix + "/?$").toStdString()];
+void SimpleWebSocketServerBase::countHTTPResponse(std::chrono::system_clock::time_point headerReadTime, int status)
+{
+	metrics.addHTTPRequest(status, std::chrono::duration<double>(std::chrono::system_clock::now() - headerReadTime).count());
+}
 
-		wsEndpoint.on_message = std::bind(&SimpleWebSocketServer::onMessageCallback, this, std::placeholders::_1, std::placeholders::_2);
-		wsEndpoint.on_error = std::bind(&SimpleWebSocketServer::onErrorCallback, this, std::placeholders::_1, std::placeholders::_2);
-		wsEndpoint.on_open = std::bind(&SimpleWebSocketServer::onNewConnectionCallback, this, std::placeholders::_1);
-		wsEndpoint.on_close = std::bind(&SimpleWebSocketServer::onConnectionCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+void SimpleWebSocketServerBase::dispatchMessage(const String& id, const WebSocketPayload& payload)
+{
+	webSocketListeners.call(&Listener::payloadReceived, id, payload);
+	if (!convertMessages) return;
 
-		http->config.timeout_request = 1;
-		http->config.timeout_content = 300;
-		http->config.max_request_streambuf_size = 1000000;
-		http->config.thread_pool_size = 4;
-		http->config.reuse_address = allowAddressReuse;
+	if (payload.isText()) webSocketListeners.call(&Listener::messageReceived, id, payload.toString());
+	else webSocketListeners.call(&Listener::dataReceived, id, payload.toMemoryBlock());
+}
 
-		DBG("Http start");
+bool SimpleWebSocketServerBase::addHandlerJob(std::function<void()> job)
+{
+	ScopedLock lock(handlerPoolLock);
+	if (numPendingHandlerJobs.get() >= maxPendingHandlerJobs) return false;
 
-		http->start(std::bind(&SimpleWebSocketServer::httpStartCallback, this, std::placeholders::_1));
+	if (handlerPool == nullptr) handlerPool.reset(new ThreadPool(jmax(1, numHandlerThreads)));
 
-		DBG("Service run");
-		isConnected = true;
-		isConnecting = false;
+	++numPendingHandlerJobs;
+	handlerPool->addJob([this, job]
+		{
+			try
+			{
+				job();
+			}
+			catch (std::exception& e)
+			{
+				DBG("Error in deferred HTTP handler " << e.what());
+			}
+			--numPendingHandlerJobs;
+		});
 
-		webSocketListeners.call(&Listener::serverInitSuccess);
+	return true;
+}
 
-		if (ioService != nullptr)
-		{
-			ioService->run();
-		}
+void SimpleWebSocketServerBase::stopHandlerJobs()
+{
+	// The pools are waited for outside the lock, so that their jobs don't block on it while they finish
+	std::unique_ptr<ThreadPool> pool, retiredPool, ownPool;
+	{
+		ScopedLock lock(handlerPoolLock);
+		pool = std::move(handlerPool);
+		retiredPool = std::move(retiredHandlerPool);
 	}
-	catch (std::exception e)
+
+	// A job stopping the server can't wait for its own pool, which is then kept until the next stop or the destructor
+	const ThreadPoolJob* currentJob = ThreadPoolJob::getCurrentThreadPoolJob();
+	for (std::unique_ptr<ThreadPool>* p : { &pool, &retiredPool })
 	{
-		DBG("Error init server " << e.what());
-		webSocketListeners.call(&Listener::serverInitError, e.what());
+		if (currentJob == nullptr || *p == nullptr || !(*p)->contains(currentJob)) continue;
+		(*p)->removeAllJobs(true, 0);
+		ownPool = std::move(*p);
 	}
-}
 
-int SimpleWebSocketServer::getNumActiveConnections() const
-{
-	return connectionMap.size();
-}
+	if (pool != nullptr) pool->removeAllJobs(true, 2000);
+	pool.reset();
+	retiredPool.reset();
 
-String SimpleWebSocketServer::getConnectionString(std::shared_ptr<WsServer::Connection> connection) const
-{
-	return String(connection->remote_endpoint().address().to_string()) + ":" + String(connection->remote_endpoint().port());
+	ScopedLock lock(handlerPoolLock);
+	if (ownPool != nullptr) retiredHandlerPool = std::move(ownPool);
+
+	// Jobs removed before they ran never count themselves out, so the count restarts from the jobs left
+	numPendingHandlerJobs = (handlerPool != nullptr ? handlerPool->getNumJobs() : 0) + (retiredHandlerPool != nullptr ? retiredHandlerPool->getNumJobs() : 0);
 }
 
 void SimpleWebSocketServerBase::serveFile(const File& file, std::shared_ptr<HttpServer::Response> response)
 {
 	String contentType = MIMETypes::getMIMEType(file.getFileExtension());
 
-	bool fileIsText = contentType.contains("text") || contentType.contains("json") || contentType.contains("script") || contentType.contains("css");
-
 	SimpleWeb::CaseInsensitiveMultimap header;
 	header.emplace("Content-Length", String(file.getSize()).toStdString());
 	header.emplace("Content-Type", contentType.toStdString());
@@ -284,26 +294,13 @@ void SimpleWebSocketServerBase::serveFile(const File& file, std::shared_ptr<Http
 	header.emplace("Access-Control-Allow-Origin", "*");
 
 	response->write(SimpleWeb::StatusCode::success_ok, header);
-
-	if (fileIsText)
-	{
-		*response << file.loadFileAsString().toStdString();
-	}
-	else
-	{
-		MemoryBlock b;
-		std::unique_ptr<FileInputStream> fs = file.createInputStream();
-		fs->readIntoMemoryBlock(b);
-		response->write((const char*) b.getData(), b.getSize());
-	}
+	response->send_file(file.getFullPathName().toStdString());
 }
 
 void SimpleWebSocketServerBase::serveFile(const File& file, std::shared_ptr<HttpsServer::Response> response)
 {
 	String contentType = MIMETypes::getMIMEType(file.getFileExtension());
 
-	bool fileIsText = contentType.contains("text") || contentType.contains("json") || contentType.contains("script") || contentType.contains("css");
-
 	SimpleWeb::CaseInsensitiveMultimap header;
 	header.emplace("Content-Length", String(file.getSize()).toStdString());
 	header.emplace("Content-Type", contentType.toStdString());
@@ -311,224 +308,202 @@ void SimpleWebSocketServerBase::serveFile(const File& file, std::shared_ptr<Http
 	header.emplace("Access-Control-Allow-Origin", "*");
 
 	response->write(SimpleWeb::StatusCode::success_ok, header);
-
-	if (fileIsText)
-	{
-		*response << file.loadFileAsString().toStdString();
-	}
-	else
-	{
-		MemoryBlock b;
-		std::unique_ptr<FileInputStream> fs = file.createInputStream();
-		fs->readIntoMemoryBlock(b);
-		response->write((const char*) b.getData(), b.getSize());
-	}
+	response->send_file(file.getFullPathName().toStdString());
 }
 
-void SimpleWebSocketServer::onMessageCallback(std::shared_ptr<WsServer::Connection> connection, std::shared_ptr<WsServer::InMessage> in_message)
-{
-	String id = getConnectionString(connection);
-	if (in_message->fin_rsv_opcode == 129)
-	{
-		webSocketListeners.call(&Listener::messageReceived, id, String(in_message->string()));
-	}
-	else if (in_message->fin_rsv_opcode == 130)
-	{
-		MemoryBlock b(in_message->string().c_str(), in_message->size());
-		webSocketListeners.call(&Listener::dataReceived, id, b);
-	}
-	else if (in_message->fin_rsv_opcode == 136)
-	{
-		DBG("Connection ended for " << id);
-	}
-}
+// TRANSPORTS
 
-void SimpleWebSocketServer::onNewConnectionCallback(std::shared_ptr<WsServer::Connection> connection)
+template <>
+void SimpleWebSocketServerImpl<SimpleWeb::HTTP>::createServers()
 {
-	String id = getConnectionString(connection);
-	connectionMap.set(id, connection);
-	webSocketListeners.call(&Listener::connectionOpened, id);
+	http.reset(new HttpServer());
+	ws.reset(new WsServer());
 }
 
-void SimpleWebSocketServer::onConnectionCloseCallback(std::shared_ptr<WsServer::Connection> connection, int status, const std::string& reason)
+template <>
+void SimpleWebSocketServerImpl<SimpleWeb::HTTP>::addTransportMetrics()
 {
-	String id = getConnectionString(connection);
-	connectionMap.remove(id);
-	webSocketListeners.call(&Listener::connectionClosed, id, status, reason);
 }
 
-void SimpleWebSocketServer::onErrorCallback(std::shared_ptr<WsServer::Connection> connection, const SimpleWeb::error_code& ec)
+#if SIMPLEWEB_SECURE_SUPPORTED
+ServerTransport<SimpleWeb::HTTPS>::ServerTransport(const String& certFile, const String& privateKeyFile, const String& verifyFile) :
+	certFile(certFile),
+	keyFile(privateKeyFile),
+	verifyFile(verifyFile),
+	tlsSessionCacheSize(20 * 1024),
+	tlsSessionTimeoutSeconds(7200),
+	tlsSessionTickets(true),
+	tlsTicketKeyRotationSeconds(3600),
+	numHandshakeThreads(0),
+	kernelTLS(false),
+	tlsInitialRecordSize(1400)
 {
-	String id = getConnectionString(connection);
-	connectionMap.remove(id);
-	webSocketListeners.call(&Listener::connectionError, id, ec.message());
 }
 
-void SimpleWebSocketServer::httpStartCallback(unsigned short _port)
+template <>
+void SimpleWebSocketServerImpl<SimpleWeb::HTTPS>::createServers()
 {
-	isConnected = port == _port;
-}
+	http.reset(new HttpsServer(certFile.toStdString(), keyFile.toStdString(), verifyFile.toStdString()));
+	http->on_handshake = [this](const SimpleWeb::error_code& ec, bool resumed)
+		{
+			metrics.increment(ec ? ServerMetrics::TLSHandshakeErrors : ServerMetrics::TLSHandshakes);
+			if (resumed) metrics.increment(ServerMetrics::TLSResumedHandshakes);
+		};
 
-void SimpleWebSocketServer::onHTTPUpgrade(std::unique_ptr<SimpleWeb::HTTP>& socket, std::shared_ptr<HttpServer::Request> request)
-{
-	jassert(ws != nullptr);
+	http->config.tls_session_cache_size = (size_t)jmax(0, tlsSessionCacheSize);
+	http->config.tls_session_timeout = tlsSessionTimeoutSeconds;
+	http->config.tls_session_tickets = tlsSessionTickets;
+	http->config.tls_ticket_key_rotation = tlsTicketKeyRotationSeconds;
+	http->config.handshake_thread_pool_size = (size_t)jmax(0, numHandshakeThreads);
+	http->config.kernel_tls = kernelTLS;
+	http->config.tls_initial_record_size = (size_t)jmax(0, tlsInitialRecordSize);
 
-	auto connection = std::make_shared<WsServer::Connection>(std::move(socket));
-	connection->method = std::move(request->method);
-	connection->path = std::move(request->path);
-	connection->http_version = std::move(request->http_version);
-	connection->header = std::move(request->header);
-	ws->upgrade(connection);
+	// Only takes over the connections upgraded by http, so its own TLS context is not used
+	ws.reset(new WssServer(certFile.toStdString(), keyFile.toStdString(), verifyFile.toStdString()));
 }
 
-void SimpleWebSocketServer::httpDefaultCallback(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request)
+template <>
+void SimpleWebSocketServerImpl<SimpleWeb::HTTPS>::addTransportMetrics()
 {
-	for (auto& secondaryHandler : handlers)
-	{
-		if (secondaryHandler->handleHTTPRequest(response, request))
-		{
-			return;
-		}
-	}
-
-	if (rootPath.exists() && rootPath.isDirectory())
-	{
-		// String content = "";
-		String contentType = "text/html";
-		File f;
-
-		String path = request->path.substr(1);
-		if (path.isEmpty())
-		{
-			path = "index.html";
-		}
-		f = rootPath.getChildFile(path); // substr to remove the first "/"
-
-		if (f.exists() && f.isDirectory())
-		{
-			f = f.getChildFile("index.html");
-		}
-
-		if (f.existsAsFile())
+	metrics.addGauge("simpleweb_tls_resumption_ratio", "Share of the successful TLS handshakes that resumed a session.", [this]()
 		{
-			// check that file is not outside rootPath
-			if (!f.isAChildOf(rootPath))
-			{
-				*response << "HTTP/1.1 403 Forbidden";
-				serveFile(rootPath.getChildFile("403.html"), response);
-				return;
-			}
-
-			serveFile(f, response);
-			return;
-		}
-		else
-		{
-			DBG("WebServer requested file not found : " << f.getFullPathName());
-		}
-	}
-
-	*response << "HTTP/1.1 404 Not Found";
+			const uint64 handshakes = metrics.getCounter(ServerMetrics::TLSHandshakes);
+			return handshakes > 0 ? (double)metrics.getCounter(ServerMetrics::TLSResumedHandshakes) / (double)handshakes : 0.0;
+		});
 }
+#endif
 
-// SECURE
-
-#if SIMPLEWEB_SECURE_SUPPORTED
-
-SecureWebSocketServer::SecureWebSocketServer(const String& certFile, const String& privateKeyFile, const String& verifyFile) : certFile(certFile), keyFile(privateKeyFile), verifyFile(verifyFile) {}
+// SERVER
 
-SecureWebSocketServer::~SecureWebSocketServer()
+template <class SocketType>
+SimpleWebSocketServerImpl<SocketType>::~SimpleWebSocketServerImpl()
 {
 	stop();
 }
 
-void SecureWebSocketServer::send(const String& message)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::send(const String& message)
 {
-	HashMap<String, std::shared_ptr<WssServer::Connection>>::Iterator it(connectionMap);
+	typename decltype(connectionMap)::Iterator it(connectionMap);
 	while (it.next())
 	{
-		it.getValue()->send(message.toStdString());
+		it.getValue()->send(message.toStdString(), countOutgoingMessage(1, message.getNumBytesAsUTF8()));
 	}
 }
 
-void SecureWebSocketServer::send(const char* data, int numData)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::send(const char* data, int numData)
 {
-	std::shared_ptr<WssServer::OutMessage> out_message = std::make_shared<WssServer::OutMessage>();
+	auto out_message = std::make_shared<typename WsServerType::OutMessage>();
 	out_message->write(data, numData);
-	HashMap<String, std::shared_ptr<WssServer::Connection>>::Iterator it(connectionMap);
+	typename decltype(connectionMap)::Iterator it(connectionMap);
 	while (it.next())
 	{
-		it.getValue()->send(out_message, nullptr, 130); // 130 = binary
+		it.getValue()->send(out_message, countOutgoingMessage(2, out_message->size()), 130); // 130 = binary
 	}
 }
 
-void SecureWebSocketServer::sendTo(const String& message, const String& id)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendTo(const String& message, const String& id)
 {
 	if (connectionMap.contains(id))
 	{
-		connectionMap[id]->send(message.toStdString());
+		connectionMap[id]->send(message.toStdString(), countOutgoingMessage(1, message.getNumBytesAsUTF8()));
 	}
 	else
 	{
-		DBG("[Dashboard] Websocket connection not found : " << id);
+		metrics.increment(ServerMetrics::DroppedFrames);
+		DBG("Websocket connection not found : " << id);
 	}
 }
 
-void SecureWebSocketServer::sendTo(const MemoryBlock& data, const String& id)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendTo(const MemoryBlock& data, const String& id)
 {
-	std::shared_ptr<WssServer::OutMessage> out_message = std::make_shared<WssServer::OutMessage>();
+	auto out_message = std::make_shared<typename WsServerType::OutMessage>();
 	out_message->write((const char*) data.getData(), data.getSize());
 	if (connectionMap.contains(id))
 	{
-		connectionMap[id]->send(out_message, nullptr, 130); // 130 = binary
+		connectionMap[id]->send(out_message, countOutgoingMessage(2, out_message->size()), 130); // 130 = binary
 	}
 	else
 	{
-		DBG("[Dashboard] Websocket connection not found : " << id);
+		metrics.increment(ServerMetrics::DroppedFrames);
+		DBG("Websocket connection not found : " << id);
 	}
 }
 
-void SecureWebSocketServer::sendExclude(const String& message, const StringArray excludeIds)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendExclude(const String& message, const StringArray excludeIds)
 {
-	HashMap<String, std::shared_ptr<WssServer::Connection>>::Iterator it(connectionMap);
+	typename decltype(connectionMap)::Iterator it(connectionMap);
 	while (it.next())
 	{
 		if (excludeIds.contains(it.getKey()))
 		{
 			continue;
 		}
-		it.getValue()->send(message.toStdString());
+		it.getValue()->send(message.toStdString(), countOutgoingMessage(1, message.getNumBytesAsUTF8()));
 	}
 }
 
-void SecureWebSocketServer::sendExclude(const MemoryBlock& data, const StringArray excludeIds)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendExclude(const MemoryBlock& data, const StringArray excludeIds)
 {
-	std::shared_ptr<WssServer::OutMessage> out_message = std::make_shared<WssServer::OutMessage>();
+	auto out_message = std::make_shared<typename WsServerType::OutMessage>();
 	out_message->write((const char*) data.getData(), data.getSize());
 
-	HashMap<String, std::shared_ptr<WssServer::Connection>>::Iterator it(connectionMap);
+	typename decltype(connectionMap)::Iterator it(connectionMap);
 	while (it.next())
 	{
 		if (excludeIds.contains(it.getKey()))
 		{
 			continue;
 		}
-		it.getValue()->send(out_message, nullptr, 130); // 130 = binary
+		it.getValue()->send(out_message, countOutgoingMessage(2, out_message->size()), 130); // 130 = binary
 	}
 }
 
-void SecureWebSocketServer::stopInternal()
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendMessagePack(const var& value)
 {
-	if (ioService != nullptr)
+	auto out_message = std::make_shared<typename WsServerType::OutMessage>();
+	MessagePack::write(*out_message, value);
+	typename decltype(connectionMap)::Iterator it(connectionMap);
+	while (it.next())
 	{
-		ioService->stop();
+		it.getValue()->send(out_message, countOutgoingMessage(2, out_message->size()), 130); // 130 = binary
+	}
+}
+
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::sendMessagePackTo(const var& value, const String& id)
+{
+	if (connectionMap.contains(id))
+	{
+		auto out_message = std::make_shared<typename WsServerType::OutMessage>();
+		MessagePack::write(*out_message, value);
+		connectionMap[id]->send(out_message, countOutgoingMessage(2, out_message->size()), 130); // 130 = binary
 	}
+	else
+	{
+		metrics.increment(ServerMetrics::DroppedFrames);
+		DBG("Websocket connection not found : " << id);
+	}
+}
 
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::stopInternal()
+{
+	if (ioService != nullptr && !isSharedIOService())
+	{
+		ioService->stop();
+	}
 	ScopedLock lock(serverLock);
 
 	if (ws != nullptr)
 	{
-		std::unordered_set<std::shared_ptr<WssServer::Connection>> connections = ws->get_connections();
+		auto connections = ws->get_connections();
 		for (auto& c : connections)
 		{
 			c->send_close(1000, "Server destroyed");
@@ -543,12 +518,19 @@ void SecureWebSocketServer::stopInternal()
 		http->stop();
 	}
 
+	// Destroying the servers waits for their handlers to return. From a handler this would wait for itself,
+	// so they are then left to the next initServer or the destructor.
+	if (isIOThread()) return;
+
 	ws.reset();
 	http.reset();
 	ioService.reset();
+
+	stopThread(1000);
 }
 
-void SecureWebSocketServer::closeConnectionInternal(const String& id, int code, const String& reason)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::closeConnectionInternal(const String& id, int code, const String& reason)
 {
 	if (!connectionMap.contains(id))
 	{
@@ -557,48 +539,65 @@ void SecureWebSocketServer::closeConnectionInternal(const String& id, int code,
 	connectionMap[id]->send_close(code, reason.toStdString());
 }
 
-void SecureWebSocketServer::initServer()
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::initServer()
 {
 	ScopedLock lock(serverLock);
 
 	try
 	{
-		ioService = std::make_shared<asio::io_service>();
+		ioService = createIOService();
+		DBG("Servers create");
+		createServers();
 
-		http.reset(new HttpsServer(certFile.toStdString(), keyFile.toStdString(), verifyFile.toStdString()));
+		if (localAddress.isNotEmpty())
+		{
+			http->config.address = localAddress.toStdString();
+		}
 		http->config.port = port;
+		http->config.unix_socket_path = unixSocketPath.toStdString();
+		http->config.listen_tcp = listenTCP;
 		http->io_service = ioService;
 
-		http->default_resource["GET"] = std::bind(&SecureWebSocketServer::httpDefaultCallback, this, std::placeholders::_1, std::placeholders::_2);
-		http->on_upgrade = std::bind(&SecureWebSocketServer::onHTTPUpgrade, this, std::placeholders::_1, std::placeholders::_2);
+		std::function<void(std::shared_ptr<typename HttpServerType::Response>, std::shared_ptr<typename HttpServerType::Request>)> httpCallbackFunc = std::bind(&SimpleWebSocketServerImpl::httpDefaultCallback, this, std::placeholders::_1, std::placeholders::_2);
+		http->default_resource["GET"] = httpCallbackFunc;
+		http->default_resource["POST"] = httpCallbackFunc;
+		http->default_resource["PUT"] = httpCallbackFunc;
+		http->default_resource["DELETE"] = httpCallbackFunc;
+		http->default_resource["PATCH"] = httpCallbackFunc;
+		http->on_upgrade = std::bind(&SimpleWebSocketServerImpl::onHTTPUpgrade, this, std::placeholders::_1, std::placeholders::_2);
+		http->on_request_body = std::bind(&SimpleWebSocketServerImpl::httpRequestBodyCallback, this, std::placeholders::_1, std::placeholders::_2);
+		http->on_accept = [this]() { metrics.increment(ServerMetrics::ConnectionsAccepted); };
+		http->on_response = [this](std::shared_ptr<typename HttpServerType::Request> request, int status, const SimpleWeb::error_code&) { countHTTPResponse(request->header_read_time, status); };
 
 		// WebSocket init
-		ws.reset(new WssServer(certFile.toStdString(), keyFile.toStdString(), verifyFile.toStdString()));
-		// ws->config.timeout_idle = 1;
-		ws->config.timeout_request = 2;
-
+		ws->config.low_footprint = lowFootprint;
 		auto& wsEndpoint = ws->endpoint[("^" + wsSuffix + "/?$").toStdString()];
 
-		wsEndpoint.on_message = std::bind(&SecureWebSocketServer::onMessageCallback, this, std::placeholders::_1, std::placeholders::_2);
-		wsEndpoint.on_error = std::bind(&SecureWebSocketServer::onErrorCallback, this, std::placeholders::_1, std::placeholders::_2);
-		wsEndpoint.on_open = std::bind(&SecureWebSocketServer::onNewConnectionCallback, this, std::placeholders::_1);
-		wsEndpoint.on_close = std::bind(&SecureWebSocketServer::onConnectionCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+		wsEndpoint.on_message = std::bind(&SimpleWebSocketServerImpl::onMessageCallback, this, std::placeholders::_1, std::placeholders::_2);
+		wsEndpoint.on_error = std::bind(&SimpleWebSocketServerImpl::onErrorCallback, this, std::placeholders::_1, std::placeholders::_2);
+		wsEndpoint.on_open = std::bind(&SimpleWebSocketServerImpl::onNewConnectionCallback, this, std::placeholders::_1);
+		wsEndpoint.on_close = std::bind(&SimpleWebSocketServerImpl::onConnectionCloseCallback, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+		wsEndpoint.on_ping = [this](std::shared_ptr<typename WsServerType::Connection>) { countPing(); };
+		wsEndpoint.on_pong = [this](std::shared_ptr<typename WsServerType::Connection>) { metrics.addMessage(ServerMetrics::Incoming, 10, 0); };
 
 		http->config.timeout_request = 1;
-		http->config.timeout_content = 2;
+		http->config.timeout_content = 300;
 		http->config.max_request_streambuf_size = 1000000;
-		http->config.thread_pool_size = 2;
+		http->config.thread_pool_size = 4;
 		http->config.reuse_address = allowAddressReuse;
-		http->start(std::bind(&SecureWebSocketServer::httpStartCallback, this, std::placeholders::_1));
 
+		DBG("Http start");
+
+		http->start(std::bind(&SimpleWebSocketServerImpl::httpStartCallback, this, std::placeholders::_1));
+
+		DBG("Service run");
 		isConnected = true;
 		isConnecting = false;
+
 		webSocketListeners.call(&Listener::serverInitSuccess);
 
-		if (ioService != nullptr)
-		{
-			ioService->run();
-		}
+		runIOService();
 	}
 	catch (std::exception e)
 	{
@@ -607,26 +606,40 @@ void SecureWebSocketServer::initServer()
 	}
 }
 
-int SecureWebSocketServer::getNumActiveConnections() const
+template <class SocketType>
+int SimpleWebSocketServerImpl<SocketType>::getNumActiveConnections() const
 {
 	return connectionMap.size();
 }
 
-String SecureWebSocketServer::getConnectionString(std::shared_ptr<WssServer::Connection> connection) const
+template <class SocketType>
+int SimpleWebSocketServerImpl<SocketType>::getSendQueueDepth() const
+{
+	if (ws == nullptr) return 0;
+
+	size_t depth = 0;
+	for (auto& c : ws->get_connections()) depth += c->send_queue_size();
+	return (int)depth;
+}
+
+template <class SocketType>
+String SimpleWebSocketServerImpl<SocketType>::getConnectionString(std::shared_ptr<typename WsServerType::Connection> connection) const
 {
+	// Connections over unixSocketPath have no address, and are told apart by the connection object instead
+	if (connection->remote_endpoint().port() == 0) return "unix:" + String::toHexString((int64)(pointer_sized_int)connection.get());
 	return String(connection->remote_endpoint().address().to_string()) + ":" + String(connection->remote_endpoint().port());
 }
 
-void SecureWebSocketServer::onMessageCallback(std::shared_ptr<WssServer::Connection> connection, std::shared_ptr<WssServer::InMessage> in_message)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::onMessageCallback(std::shared_ptr<typename WsServerType::Connection> connection, std::shared_ptr<typename WsServerType::InMessage> in_message)
 {
+	metrics.addMessage(ServerMetrics::Incoming, in_message->fin_rsv_opcode & 0x0f, in_message->size());
+
 	String id = getConnectionString(connection);
-	if (in_message->fin_rsv_opcode == 129)
+	if (in_message->fin_rsv_opcode == 129 || in_message->fin_rsv_opcode == 130)
 	{
-		webSocketListeners.call(&Listener::messageReceived, id, String(in_message->string()));
-	}
-	else if (in_message->fin_rsv_opcode == 130)
-	{
-		webSocketListeners.call(&Listener::dataReceived, id, in_message->binary);
+		// The payload keeps in_message alive, whose buffer already holds the unmasked bytes
+		dispatchMessage(id, WebSocketPayload(in_message, in_message->data(), in_message->size(), in_message->fin_rsv_opcode & 0x0f));
 	}
 	else if (in_message->fin_rsv_opcode == 136)
 	{
@@ -634,37 +647,43 @@ void SecureWebSocketServer::onMessageCallback(std::shared_ptr<WssServer::Connect
 	}
 }
 
-void SecureWebSocketServer::onNewConnectionCallback(std::shared_ptr<WssServer::Connection> connection)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::onNewConnectionCallback(std::shared_ptr<typename WsServerType::Connection> connection)
 {
+	metrics.increment(ServerMetrics::WebSocketHandshakes);
 	String id = getConnectionString(connection);
 	connectionMap.set(id, connection);
 	webSocketListeners.call(&Listener::connectionOpened, id);
 }
 
-void SecureWebSocketServer::onConnectionCloseCallback(std::shared_ptr<WssServer::Connection> connection, int status, const std::string& reason)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::onConnectionCloseCallback(std::shared_ptr<typename WsServerType::Connection> connection, int status, const std::string& reason)
 {
 	String id = getConnectionString(connection);
 	connectionMap.remove(id);
 	webSocketListeners.call(&Listener::connectionClosed, id, status, reason);
 }
 
-void SecureWebSocketServer::onErrorCallback(std::shared_ptr<WssServer::Connection> connection, const SimpleWeb::error_code& ec)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::onErrorCallback(std::shared_ptr<typename WsServerType::Connection> connection, const SimpleWeb::error_code& ec)
 {
 	String id = getConnectionString(connection);
 	connectionMap.remove(id);
 	webSocketListeners.call(&Listener::connectionError, id, ec.message());
 }
 
-void SecureWebSocketServer::httpStartCallback(unsigned short _port)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::httpStartCallback(unsigned short _port)
 {
-	isConnected = port == _port;
+	isConnected = !listenTCP || port == _port;
 }
 
-void SecureWebSocketServer::onHTTPUpgrade(std::unique_ptr<SimpleWeb::HTTPS>& socket, std::shared_ptr<HttpsServer::Request> request)
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::onHTTPUpgrade(std::unique_ptr<SocketType>& socket, std::shared_ptr<typename HttpServerType::Request> request)
 {
 	jassert(ws != nullptr);
 
-	auto connection = std::make_shared<WssServer::Connection>(std::move(socket));
+	auto connection = std::make_shared<typename WsServerType::Connection>(std::move(socket));
 	connection->method = std::move(request->method);
 	connection->path = std::move(request->path);
 	connection->http_version = std::move(request->http_version);
@@ -672,11 +691,37 @@ void SecureWebSocketServer::onHTTPUpgrade(std::unique_ptr<SimpleWeb::HTTPS>& soc
 	ws->upgrade(connection);
 }
 
-void SecureWebSocketServer::httpDefaultCallback(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request)
+template <class SocketType>
+SimpleWeb::StatusCode SimpleWebSocketServerImpl<SocketType>::httpRequestBodyCallback(std::shared_ptr<typename HttpServerType::Request> request, std::shared_ptr<typename HttpServerType::BodyStream>& bodyStream)
 {
-	for (auto& handler : handlers)
+	for (auto& secondaryHandler : handlers)
+	{
+		SimpleWeb::StatusCode status = prepareRequestBody(secondaryHandler, request, bodyStream);
+		if (status != SimpleWeb::StatusCode::success_ok || bodyStream != nullptr)
+		{
+			return status;
+		}
+	}
+
+	return SimpleWeb::StatusCode::success_ok;
+}
+
+template <class SocketType>
+void SimpleWebSocketServerImpl<SocketType>::httpDefaultCallback(std::shared_ptr<typename HttpServerType::Response> response, std::shared_ptr<typename HttpServerType::Request> request)
+{
+	if (handleMetricsRequest(response, request))
+	{
+		return;
+	}
+
+	if (handleEventStreamRequest(response, request))
+	{
+		return;
+	}
+
+	for (auto& secondaryHandler : handlers)
 	{
-		if (handler->handleHTTPSRequest(response, request))
+		if (handleRequest(secondaryHandler, response, request))
 		{
 			return;
 		}
@@ -684,14 +729,15 @@ void SecureWebSocketServer::httpDefaultCallback(std::shared_ptr<HttpsServer::Res
 
 	if (rootPath.exists() && rootPath.isDirectory())
 	{
-		// String content = "";
 		File f;
+
 		String path = request->path.substr(1);
 		if (path.isEmpty())
 		{
 			path = "index.html";
 		}
 		f = rootPath.getChildFile(path); // substr to remove the first "/"
+
 		if (f.exists() && f.isDirectory())
 		{
 			f = f.getChildFile("index.html");
@@ -699,6 +745,14 @@ void SecureWebSocketServer::httpDefaultCallback(std::shared_ptr<HttpsServer::Res
 
 		if (f.existsAsFile())
 		{
+			// check that file is not outside rootPath
+			if (!f.isAChildOf(rootPath))
+			{
+				*response << "HTTP/1.1 403 Forbidden";
+				serveFile(rootPath.getChildFile("403.html"), response);
+				return;
+			}
+
 			serveFile(f, response);
 			return;
 		}
@@ -711,4 +765,7 @@ void SecureWebSocketServer::httpDefaultCallback(std::shared_ptr<HttpsServer::Res
 	*response << "HTTP/1.1 404 Not Found";
 }
 
+template class SimpleWebSocketServerImpl<SimpleWeb::HTTP>;
+#if SIMPLEWEB_SECURE_SUPPORTED
+template class SimpleWebSocketServerImpl<SimpleWeb::HTTPS>;
 #endif
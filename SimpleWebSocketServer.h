@@ -22,6 +22,86 @@ using WssServer = SimpleWeb::SocketServer<SimpleWeb::WSS>;
 using HttpsServer = SimpleWeb::Server<SimpleWeb::HTTPS>;
 #endif
 
+/// @brief An HTTP response that is completed later, usually from a handler worker thread.
+/// It keeps the response alive until complete() or claim() is called. If a deadline has been set and expires first,
+/// 503 Service Unavailable is sent instead; if it is released without being completed, 500 is sent.
+template <class ServerType>
+class DeferredResponse :
+	public std::enable_shared_from_this<DeferredResponse<ServerType>>
+{
+public:
+	typedef typename ServerType::Response Response;
+	typedef typename ServerType::Request Request;
+
+	DeferredResponse(std::shared_ptr<Response> response, std::shared_ptr<Request> request) :
+		request(request),
+		response(response),
+		answered(false)
+	{
+	}
+
+	~DeferredResponse()
+	{
+		complete(SimpleWeb::StatusCode::server_error_internal_server_error, "Request was not answered");
+	}
+
+	const std::shared_ptr<Request> request;
+
+	/// @brief Sends the response. Returns false if it has already been answered, for instance because the deadline expired.
+	bool complete(SimpleWeb::StatusCode status, const std::string& content = std::string(), const SimpleWeb::CaseInsensitiveMultimap& header = SimpleWeb::CaseInsensitiveMultimap())
+	{
+		std::shared_ptr<Response> r = claim();
+		if (r == nullptr) return false;
+		r->write(status, content, header);
+		return true;
+	}
+
+	/// @brief Takes over the response to write it directly, it is sent when the returned pointer is released.
+	/// Returns nullptr if the response has already been answered.
+	std::shared_ptr<Response> claim()
+	{
+		if (answered.exchange(true)) return nullptr;
+
+		if (deadline != nullptr)
+		{
+			std::shared_ptr<asio::steady_timer> timer = deadline;
+			SimpleWeb::post(*ioService, [timer] { timer->cancel(); });
+		}
+
+		return std::move(response);
+	}
+
+	bool isPending() const { return !answered; }
+
+	/// @brief Sends 503 Service Unavailable if the response has not been completed after timeoutMs. Call once, before sharing the object.
+	void setDeadline(std::shared_ptr<asio::io_service> service, int timeoutMs)
+	{
+		ioService = service;
+		deadline = std::make_shared<asio::steady_timer>(*ioService, std::chrono::milliseconds(timeoutMs));
+
+		std::weak_ptr<DeferredResponse> weak = this->shared_from_this();
+		deadline->async_wait([weak](const SimpleWeb::error_code& ec)
+			{
+				if (ec) return;
+				if (std::shared_ptr<DeferredResponse> self = weak.lock())
+				{
+					self->complete(SimpleWeb::StatusCode::server_error_service_unavailable, "Request timed out");
+				}
+			});
+	}
+
+private:
+	std::shared_ptr<Response> response;
+	std::atomic<bool> answered;
+	std::shared_ptr<asio::io_service> ioService; // Keeps the timer's io_service alive
+	std::shared_ptr<asio::steady_timer> deadline;
+};
+
+using DeferredHTTPResponse = DeferredResponse<HttpServer>;
+#if SIMPLEWEB_SECURE_SUPPORTED
+using DeferredHTTPSResponse = DeferredResponse<HttpsServer>;
+#endif
+
 class SimpleWebSocketServerBase :
 	public juce::Thread
 {
@@ -33,11 +113,26 @@ public:
 	juce::String localAddress;
 	int port;
 	bool allowAddressReuse;
+	juce::String unixSocketPath; // Also listen on this Unix domain socket, for processes on the same host connecting to "unix:<path>:<wsSuffix>". Plain servers only, not on Windows, empty to disable
+	bool listenTCP; // Set to false to only listen on unixSocketPath
 	juce::String wsSuffix;
 	bool isConnected;
 	bool isConnecting;
 
+	int numHandlerThreads; // Worker threads running deferred HTTP handlers
+	int maxPendingHandlerJobs; // Deferred requests beyond this are answered with 503 right away
+	int handlerTimeoutMs; // Deferred requests not answered within this delay get a 503, 0 to disable
+
+	juce::String metricsPath; // Path on which metrics are served in the Prometheus text format, without authentication and before the handlers. Empty, the default, to disable
+	bool lowFootprint; // Trade a little CPU for less memory per idle WebSocket connection, see SimpleWeb Config::low_footprint
+
+	std::shared_ptr<IORuntime> ioRuntime; // Shared io threads to run on, e.g. IORuntime::getShared(). Set before start(), null to run on a thread of its own
+	bool convertMessages; // Also copy each message into a String or MemoryBlock for messageReceived and dataReceived. Turn off when all the listeners use payloadReceived
+
 	juce::CriticalSection serverLock;
+	std::shared_ptr<asio::io_service> ioService;
+
+	ServerMetrics metrics;
 
 	void start(int port = 8080, const juce::String& wsSuffix = "", const juce::String& _localAddress = "", bool allowAddressReuse = false);
 
@@ -49,9 +144,38 @@ public:
 	virtual void sendExclude(const juce::String& message, const juce::StringArray excludeIds) {}
 	virtual void sendExclude(const juce::MemoryBlock& data, const juce::StringArray excludeIds) {}
 
+	/// @brief Sends value as a binary MessagePack message, encoded once straight into the buffer that every connection sends.
+	virtual void sendMessagePack(const juce::var& value) {}
+	virtual void sendMessagePackTo(const juce::var& value, const juce::String& id) {}
+
 	void serveFile(const juce::File& file, std::shared_ptr<HttpServer::Response> response);
 	void serveFile(const juce::File& file, std::shared_ptr<HttpsServer::Response> response);
 
+	/// @brief Keeps the response open so that it can be completed later from any thread, see DeferredResponse.
+	std::shared_ptr<DeferredHTTPResponse> deferResponse(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
+
+	/// @brief Runs job on the handler worker pool, which then completes the response. Call it from RequestHandler::handleHTTPRequest
+	/// and return true so that slow work does not block the io threads. Returns false if too many jobs are pending,
+	/// in which case 503 Service Unavailable has already been sent.
+	bool deferHTTPRequest(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request, std::function<void(std::shared_ptr<DeferredHTTPResponse>)> job);
+
+	/// @brief Serves a server-sent events stream on GET requests to path (e.g. "/events"), for clients that can't use WebSockets.
+	std::shared_ptr<ServerSentEvents> addEventStream(const juce::String& path);
+	void removeEventStream(const juce::String& path);
+
+	/// @brief Sends an event to all the subscribers of the event stream on path.
+	void sendEvent(const juce::String& path, const juce::String& data, const juce::String& eventType = juce::String());
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+	std::shared_ptr<DeferredHTTPSResponse> deferResponse(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request);
+	bool deferHTTPSRequest(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request, std::function<void(std::shared_ptr<DeferredHTTPSResponse>)> job);
+#endif
+
+#if SIMPLEWEB_ENABLE_TRACING
+	/// @brief Writes the timings of the last WebSocket messages as Chrome trace-event JSON, to open in chrome://tracing or Perfetto.
+	static bool writeTrace(const juce::File& file);
+#endif
+
 	void stop();
 	void closeConnection(const juce::String& id, int code = 1000, const juce::String& reason = "YouKnowWhy");
 
@@ -59,6 +183,7 @@ public:
 	virtual void closeConnectionInternal(const juce::String& id, int code, const juce::String& reason) {}
 
 	virtual int getNumActiveConnections() const { return 0; }
+	virtual int getSendQueueDepth() const { return 0; }
 
 	void run() override;
 
@@ -74,6 +199,7 @@ public:
 		virtual void connectionOpened(const juce::String& id) {}
 		virtual void messageReceived(const juce::String& id, const juce::String& message) {}
 		virtual void dataReceived(const juce::String& id, const juce::MemoryBlock& data) {}
+		virtual void payloadReceived(const juce::String& id, const WebSocketPayload& payload) {} // Text and binary messages, without copy
 		virtual void connectionClosed(const juce::String& id, int status, const juce::String& reason) {}
 		virtual void connectionError(const juce::String& id, const juce::String& message) {}
 	};
@@ -89,8 +215,14 @@ public:
 		virtual ~RequestHandler() {}
 		virtual bool handleHTTPRequest(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) { return false; };
 
+		/// @brief Called before the body of a request is read. Set bodyStream to receive the body in parts as it arrives
+		/// instead of having it buffered in request->content, or return an error status to reject the request before
+		/// the client sends its body. handleHTTPRequest is called once the whole body has been received.
+		virtual SimpleWeb::StatusCode prepareHTTPRequestBody(std::shared_ptr<HttpServer::Request> request, std::shared_ptr<HttpServer::BodyStream>& bodyStream) { return SimpleWeb::StatusCode::success_ok; }
+
 #if SIMPLEWEB_SECURE_SUPPORTED
 		virtual bool handleHTTPSRequest(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request) { return false; };
+		virtual SimpleWeb::StatusCode prepareHTTPSRequestBody(std::shared_ptr<HttpsServer::Request> request, std::shared_ptr<HttpsServer::BodyStream>& bodyStream) { return SimpleWeb::StatusCode::success_ok; }
 #endif
 	};
 
@@ -102,68 +234,115 @@ public:
 
 protected:
 	juce::Array<RequestHandler*> handlers;
-};
 
+	/// @brief Calls the handler method of the transport of the request.
+	static bool handleRequest(RequestHandler* handler, std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) { return handler->handleHTTPRequest(response, request); }
+	static SimpleWeb::StatusCode prepareRequestBody(RequestHandler* handler, std::shared_ptr<HttpServer::Request> request, std::shared_ptr<HttpServer::BodyStream>& bodyStream) { return handler->prepareHTTPRequestBody(request, bodyStream); }
+#if SIMPLEWEB_SECURE_SUPPORTED
+	static bool handleRequest(RequestHandler* handler, std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request) { return handler->handleHTTPSRequest(response, request); }
+	static SimpleWeb::StatusCode prepareRequestBody(RequestHandler* handler, std::shared_ptr<HttpsServer::Request> request, std::shared_ptr<HttpsServer::BodyStream>& bodyStream) { return handler->prepareHTTPSRequestBody(request, bodyStream); }
+#endif
 
-class SimpleWebSocketServer :
-	public SimpleWebSocketServerBase
-{
-public:
-	SimpleWebSocketServer();
-	~SimpleWebSocketServer();
+	std::shared_ptr<asio::io_service> createIOService() const;
+	bool isSharedIOService() const;
+	bool isIOThread() const; // Whether the calling thread runs ioService, and may thus be inside one of its handlers
+	void runIOService();
 
-	std::unique_ptr<WsServer> ws;
-	std::unique_ptr<HttpServer> http;
+	bool addHandlerJob(std::function<void()> job);
+	void stopHandlerJobs();
 
-	std::shared_ptr<asio::io_service> ioService;
-	juce::HashMap<juce::String, std::shared_ptr<WsServer::Connection>, juce::DefaultHashFunctions, juce::CriticalSection> connectionMap;
+	std::function<void(const SimpleWeb::error_code&)> countOutgoingMessage(int opcode, size_t numBytes);
+	void countPing();
+	void countHTTPResponse(std::chrono::system_clock::time_point headerReadTime, int status);
 
-	virtual void send(const juce::String& message) override;
-	virtual void send(const char* data, int numData) override;
-	virtual void sendTo(const juce::String& message, const juce::String& id) override;
-	virtual void sendTo(const juce::MemoryBlock& data, const juce::String& id) override;
-	virtual void sendExclude(const juce::String& message, const juce::StringArray excludeIds) override;
-	virtual void sendExclude(const juce::MemoryBlock& data, const juce::StringArray excludeIds) override;
+	/// @brief Calls the listeners with a received text or binary message.
+	void dispatchMessage(const juce::String& id, const WebSocketPayload& payload);
 
-	virtual void stopInternal() override;
-	virtual void closeConnectionInternal(const juce::String& id, int code, const juce::String& reason) override;
+	template <class ResponseType, class RequestType>
+	bool handleMetricsRequest(std::shared_ptr<ResponseType> response, std::shared_ptr<RequestType> request)
+	{
+		if (metricsPath.isEmpty() || request->method != "GET" || juce::String(request->path) != metricsPath) return false;
 
-	void initServer() override;
+		SimpleWeb::CaseInsensitiveMultimap header;
+		header.emplace("Content-Type", "text/plain; version=0.0.4");
+		response->write(SimpleWeb::StatusCode::success_ok, metrics.toPrometheusText().toStdString(), header);
+		return true;
+	}
 
-	void onMessageCallback(std::shared_ptr<WsServer::Connection> connection, std::shared_ptr<WsServer::InMessage> in_message);
-	void onNewConnectionCallback(std::shared_ptr<WsServer::Connection> connection);
-	void onConnectionCloseCallback(std::shared_ptr<WsServer::Connection> connection, int status, const std::string& /*reason*/);
-	void onErrorCallback(std::shared_ptr<WsServer::Connection> connection, const SimpleWeb::error_code& ec);
+	juce::HashMap<juce::String, std::shared_ptr<ServerSentEvents>, juce::DefaultHashFunctions, juce::CriticalSection> eventStreams;
+	void stopEventStreams();
 
-	void httpStartCallback(unsigned short port);
-	void onHTTPUpgrade(std::unique_ptr<SimpleWeb::HTTP>& socket, std::shared_ptr<HttpServer::Request> request);
+	template <class ResponseType, class RequestType>
+	bool handleEventStreamRequest(std::shared_ptr<ResponseType> response, std::shared_ptr<RequestType> request)
+	{
+		if (request->method != "GET") return false;
 
-	void httpDefaultCallback(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request);
-	juce::String getConnectionString(std::shared_ptr<WsServer::Connection> connection) const;
+		std::shared_ptr<ServerSentEvents> eventStream = eventStreams[juce::String(request->path)];
+		if (eventStream == nullptr) return false;
 
+		eventStream->startHeartbeat(ioService);
+		eventStream->subscribe(response, request);
+		return true;
+	}
 
-	virtual int getNumActiveConnections() const override;
+	juce::CriticalSection handlerPoolLock;
+	juce::Atomic<int> numPendingHandlerJobs;
+	std::unique_ptr<juce::ThreadPool> handlerPool;
+	std::unique_ptr<juce::ThreadPool> retiredHandlerPool; // The pool of a job that stopped the server, which could not wait for it
 };
 
 
-#if SIMPLEWEB_SECURE_SUPPORTED
+/// @brief What a server needs on top of SimpleWebSocketServerBase for its transport. Plain servers need nothing.
+template <class SocketType>
+class ServerTransport
+{
+};
 
-class SecureWebSocketServer :
-	public SimpleWebSocketServerBase
+#if SIMPLEWEB_SECURE_SUPPORTED
+template <>
+class ServerTransport<SimpleWeb::HTTPS>
 {
 public:
-	SecureWebSocketServer(const juce::String& certFile, const juce::String& privateKeyFile, const juce::String& verifyFile = juce::String());
-	~SecureWebSocketServer();
+	ServerTransport(const juce::String& certFile, const juce::String& privateKeyFile, const juce::String& verifyFile = juce::String());
 
 	juce::String certFile;
 	juce::String keyFile;
 	juce::String verifyFile;
 
-	std::unique_ptr<WssServer> ws;
-	std::unique_ptr<HttpsServer> http;
+	int tlsSessionCacheSize; // TLS sessions kept so that returning clients can resume them, 0 to disable the cache
+	int tlsSessionTimeoutSeconds; // How long a session can be resumed, from the cache or a ticket
+	bool tlsSessionTickets; // Also hand out stateless session tickets, encrypted with keys that rotate
+	int tlsTicketKeyRotationSeconds; // Lifetime of a ticket key before the next one takes over
+	int numHandshakeThreads; // Threads running TLS handshakes, so that reconnect storms don't delay established connections. 0 runs them on the io threads
+	bool kernelTLS; // On Linux, let the kernel encrypt what is sent, so that static files go out with sendfile(). Falls back to OpenSSL when unavailable
+	int tlsInitialRecordSize; // Size of the TLS records at the start of a connection and after idle periods, so that browsers can decrypt live updates early. Grows to 16 kB for bulk transfers, 0 to always write full records
+};
+#endif
 
-	std::shared_ptr<asio::io_service> ioService;
-	juce::HashMap<juce::String, std::shared_ptr<WssServer::Connection>> connectionMap;
+/// @brief The server over one transport, SimpleWeb::HTTP for WS or SimpleWeb::HTTPS for WSS. Everything but the
+/// making of the SimpleWeb servers is shared, see createServers(). The constructor arguments are those of ServerTransport.
+template <class SocketType>
+class SimpleWebSocketServerImpl :
+	public SimpleWebSocketServerBase,
+	public ServerTransport<SocketType>
+{
+public:
+	typedef SimpleWeb::SocketServer<SocketType> WsServerType;
+	typedef SimpleWeb::Server<SocketType> HttpServerType;
+
+	template <class... TransportArgs>
+	SimpleWebSocketServerImpl(TransportArgs&&... args) :
+		ServerTransport<SocketType>(std::forward<TransportArgs>(args)...)
+	{
+		addTransportMetrics();
+	}
+
+	~SimpleWebSocketServerImpl();
+
+	std::unique_ptr<WsServerType> ws;
+	std::unique_ptr<HttpServerType> http;
+
+	juce::HashMap<juce::String, std::shared_ptr<typename WsServerType::Connection>, juce::DefaultHashFunctions, juce::CriticalSection> connectionMap;
 
 	virtual void send(const juce::String& message) override;
 	virtual void send(const char* data, int numData) override;
@@ -171,25 +350,45 @@ public:
 	virtual void sendTo(const juce::MemoryBlock& data, const juce::String& id) override;
 	virtual void sendExclude(const juce::String& message, const juce::StringArray excludeIds) override;
 	virtual void sendExclude(const juce::MemoryBlock& data, const juce::StringArray excludeIds) override;
+	virtual void sendMessagePack(const juce::var& value) override;
+	virtual void sendMessagePackTo(const juce::var& value, const juce::String& id) override;
 
 	virtual void stopInternal() override;
 	virtual void closeConnectionInternal(const juce::String& id, int code, const juce::String& reason) override;
 
-
 	void initServer() override;
 
-	void onMessageCallback(std::shared_ptr<WssServer::Connection> connection, std::shared_ptr<WssServer::InMessage> in_message);
-	void onNewConnectionCallback(std::shared_ptr<WssServer::Connection> connection);
-	void onConnectionCloseCallback(std::shared_ptr<WssServer::Connection> connection, int status, const std::string& /*reason*/);
-	void onErrorCallback(std::shared_ptr<WssServer::Connection> connection, const SimpleWeb::error_code& ec);
+	void onMessageCallback(std::shared_ptr<typename WsServerType::Connection> connection, std::shared_ptr<typename WsServerType::InMessage> in_message);
+	void onNewConnectionCallback(std::shared_ptr<typename WsServerType::Connection> connection);
+	void onConnectionCloseCallback(std::shared_ptr<typename WsServerType::Connection> connection, int status, const std::string& /*reason*/);
+	void onErrorCallback(std::shared_ptr<typename WsServerType::Connection> connection, const SimpleWeb::error_code& ec);
 
 	void httpStartCallback(unsigned short port);
-	void onHTTPUpgrade(std::unique_ptr<SimpleWeb::HTTPS>& socket, std::shared_ptr<HttpsServer::Request> request);
+	void onHTTPUpgrade(std::unique_ptr<SocketType>& socket, std::shared_ptr<typename HttpServerType::Request> request);
 
-	void httpDefaultCallback(std::shared_ptr<HttpsServer::Response> response, std::shared_ptr<HttpsServer::Request> request);
-	juce::String getConnectionString(std::shared_ptr<WssServer::Connection> connection) const;
+	void httpDefaultCallback(std::shared_ptr<typename HttpServerType::Response> response, std::shared_ptr<typename HttpServerType::Request> request);
+	SimpleWeb::StatusCode httpRequestBodyCallback(std::shared_ptr<typename HttpServerType::Request> request, std::shared_ptr<typename HttpServerType::BodyStream>& bodyStream);
+	juce::String getConnectionString(std::shared_ptr<typename WsServerType::Connection> connection) const;
 
 	virtual int getNumActiveConnections() const override;
+	virtual int getSendQueueDepth() const override;
+
+protected:
+	/// @brief Makes http and ws with the settings of the transport. Specialized for each transport.
+	void createServers();
+	void addTransportMetrics();
 };
 
+template <> void SimpleWebSocketServerImpl<SimpleWeb::HTTP>::createServers();
+template <> void SimpleWebSocketServerImpl<SimpleWeb::HTTP>::addTransportMetrics();
+extern template class SimpleWebSocketServerImpl<SimpleWeb::HTTP>;
+
+using SimpleWebSocketServer = SimpleWebSocketServerImpl<SimpleWeb::WS>;
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+template <> void SimpleWebSocketServerImpl<SimpleWeb::HTTPS>::createServers();
+template <> void SimpleWebSocketServerImpl<SimpleWeb::HTTPS>::addTransportMetrics();
+extern template class SimpleWebSocketServerImpl<SimpleWeb::HTTPS>;
+
+using SecureWebSocketServer = SimpleWebSocketServerImpl<SimpleWeb::WSS>;
 #endif
@@ -0,0 +1,45 @@
+/*
+  ==============================================================================
+
+	WebSocketPayload.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief An immutable view over the unmasked payload of a received message, as it was read from the socket.
+/// Copies share the message, which stays alive as long as one of them does, so a listener can keep a payload or hand
+/// it to another thread without copying the bytes. Text comes as raw UTF-8, not checked nor converted.
+class WebSocketPayload
+{
+public:
+	enum Opcode { Text = 1, Binary = 2 };
+
+	WebSocketPayload() {}
+	WebSocketPayload(std::shared_ptr<const void> _owner, const char* _data, size_t _size, unsigned char _opcode) :
+		owner(std::move(_owner)), data(_data), size(_size), opcode(_opcode) {}
+
+	const char* getData() const { return data; }
+	size_t getSize() const { return size; }
+	unsigned char getOpcode() const { return opcode; }
+	bool isText() const { return opcode == Text; }
+	bool isBinary() const { return opcode == Binary; }
+	bool isEmpty() const { return size == 0; }
+
+	std::string_view getView() const { return std::string_view(data, size); }
+
+	/// @brief Holding this keeps the bytes alive.
+	const std::shared_ptr<const void>& getOwner() const { return owner; }
+
+	/// @brief These copy the payload.
+	juce::String toString() const { return juce::String::fromUTF8(data, (int)size); }
+	juce::MemoryBlock toMemoryBlock() const { return juce::MemoryBlock(data, size); }
+
+private:
+	std::shared_ptr<const void> owner; // The received message the bytes belong to
+	const char* data = nullptr;
+	size_t size = 0;
+	unsigned char opcode = 0;
+};
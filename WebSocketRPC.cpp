@@ -0,0 +1,354 @@
+/*
+  ==============================================================================
+
+	WebSocketRPC.cpp
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#include "JuceHeader.h"
+
+using namespace juce;
+
+WebSocketRPC::WebSocketRPC(int _maxInFlight, int _defaultTimeoutMs) :
+	maxInFlight(jmax(1, _maxInFlight)),
+	defaultTimeoutMs(_defaultTimeoutMs),
+	slots(new Slot[(size_t)jmax(1, _maxInFlight)])
+{
+	startTimer(10);
+}
+
+WebSocketRPC::~WebSocketRPC()
+{
+	stopTimer();
+	for (int i = 0; i < maxInFlight; i++)
+	{
+		const int64 id = slots[i].pendingId.load(std::memory_order_acquire);
+		if (id != 0 && claim(slots[i], id)) release(slots[i], Response::error(Cancelled, "RPC destroyed"));
+	}
+}
+
+void WebSocketRPC::addMethod(const String& name, Method method)
+{
+	methods.set(name, method);
+}
+
+bool WebSocketRPC::call(const String& connectionId, const String& method, const var& params, Callback callback, int timeoutMs)
+{
+	// The id is a multiple of the window plus the slot index, so that a response finds its slot directly
+	const int64 sequence = ++lastId;
+	Slot* slot = nullptr;
+	int index = 0;
+	for (int i = 0; i < maxInFlight && slot == nullptr; i++)
+	{
+		index = (int)((sequence + i) % maxInFlight);
+		bool expected = false;
+		if (slots[index].busy.compare_exchange_strong(expected, true, std::memory_order_acquire)) slot = &slots[index];
+	}
+
+	if (slot == nullptr)
+	{
+		if (callback) callback(Response::error(WindowFull, "Too many calls in flight"));
+		return false;
+	}
+
+	const int64 id = sequence * maxInFlight + index;
+	if (timeoutMs < 0) timeoutMs = defaultTimeoutMs;
+
+	slot->callback = std::move(callback);
+	slot->connectionKey.store(connectionId.hashCode64(), std::memory_order_relaxed);
+	slot->deadline.store(timeoutMs > 0 ? Time::getMillisecondCounterHiRes() + timeoutMs : 0, std::memory_order_relaxed);
+	++numInFlight;
+	slot->pendingId.store(id, std::memory_order_release);
+
+	String request = "{\"jsonrpc\":\"2.0\",\"id\":" + String(id) + ",\"method\":" + JSON::toString(method);
+	if (!params.isVoid()) request += ",\"params\":" + JSON::toString(params, true);
+	request += "}";
+
+	sendText(connectionId, request);
+	return true;
+}
+
+std::future<WebSocketRPC::Response> WebSocketRPC::callFuture(const String& connectionId, const String& method, const var& params, int timeoutMs)
+{
+	std::shared_ptr<std::promise<Response>> promise = std::make_shared<std::promise<Response>>();
+	std::future<Response> future = promise->get_future();
+	call(connectionId, method, params, [promise](const Response& response) { promise->set_value(response); }, timeoutMs);
+	return future;
+}
+
+void WebSocketRPC::notify(const String& connectionId, const String& method, const var& params)
+{
+	String request = "{\"jsonrpc\":\"2.0\",\"method\":" + JSON::toString(method);
+	if (!params.isVoid()) request += ",\"params\":" + JSON::toString(params, true);
+	request += "}";
+
+	sendText(connectionId, request);
+}
+
+void WebSocketRPC::cancelCalls(const String& connectionId, const String& reason)
+{
+	const int64 key = connectionId.hashCode64();
+	for (int i = 0; i < maxInFlight; i++)
+	{
+		Slot& slot = slots[i];
+		const int64 id = slot.pendingId.load(std::memory_order_acquire);
+		if (id == 0 || slot.connectionKey.load(std::memory_order_relaxed) != key) continue;
+		if (claim(slot, id)) release(slot, Response::error(Cancelled, reason));
+	}
+}
+
+bool WebSocketRPC::handleMessage(const String& connectionId, const String& message)
+{
+	return handleMessage(connectionId, message.toRawUTF8(), message.getNumBytesAsUTF8());
+}
+
+bool WebSocketRPC::handleMessage(const String& connectionId, const char* data, size_t size)
+{
+	// Cheap checks first, since all the other messages of the connection come through here too.
+	// The envelope is read with a JSONView: juce::JSON::parse would intern each key in the global Identifier pool.
+	const std::string_view text(data, size);
+	if (text.empty() || text[0] != '{' || text.find("\"jsonrpc\"") == std::string_view::npos) return false;
+
+	const JSONView message(data, size);
+	if (!message["jsonrpc"].isValid())
+	{
+		sendResponse(connectionId, "null", Response::error(ParseError, "Parse error"));
+		return true;
+	}
+
+	const JSONView method = message["method"];
+	if (method.isValid())
+	{
+		const JSONView id = message["id"];
+		handleRequest(connectionId, method.toVar(), toVar(message["params"]), id.isValid() ? String::fromUTF8(id.getRaw().data(), (int)id.getRaw().size()) : String());
+		return true;
+	}
+
+	// Ids this side did not send, such as strings or null, match no slot
+	const int64 id = message["id"].toInt64();
+
+	const JSONView error = message["error"];
+	if (error.isValid()) complete(id, Response::error((int)error["code"].toInt64(), error["message"].toString()));
+	else complete(id, Response::success(toVar(message["result"])));
+
+	return true;
+}
+
+var WebSocketRPC::toVar(const JSONView& value)
+{
+	// A missing member is void rather than undefined, which JSON::toString would write as undefined if it was sent back
+	return value.isValid() ? value.toVar() : var();
+}
+
+void WebSocketRPC::handleRequest(const String& connectionId, const var& method, const var& params, const String& id)
+{
+	Response response;
+	if (!method.isString())
+	{
+		response = Response::error(InvalidRequest, "Invalid request");
+	}
+	else if (!methods.contains(method.toString()))
+	{
+		response = Response::error(MethodNotFound, "Method not found : " + method.toString());
+	}
+	else
+	{
+		try
+		{
+			response = methods[method.toString()](params, connectionId);
+		}
+		catch (std::exception& e)
+		{
+			response = Response::error(InternalError, e.what());
+		}
+	}
+
+	// Notifications get no response, not even an error
+	if (id.isNotEmpty()) sendResponse(connectionId, id, response);
+}
+
+void WebSocketRPC::sendResponse(const String& connectionId, const String& id, const Response& response)
+{
+	String message = "{\"jsonrpc\":\"2.0\",\"id\":" + id;
+	if (response.isOk()) message += ",\"result\":" + JSON::toString(response.result, true);
+	else message += ",\"error\":{\"code\":" + String(response.errorCode) + ",\"message\":" + JSON::toString(response.errorMessage) + "}";
+	message += "}";
+
+	sendText(connectionId, message);
+}
+
+bool WebSocketRPC::complete(int64 id, const Response& response)
+{
+	if (id <= 0) return false;
+	Slot& slot = slots[(int)(id % maxInFlight)];
+	if (!claim(slot, id)) return false; // Unknown, timed out or cancelled
+	release(slot, response);
+	return true;
+}
+
+bool WebSocketRPC::claim(Slot& slot, int64 id)
+{
+	// Only one of the response, the deadline and the cancellation can take the id out of the slot
+	return slot.pendingId.compare_exchange_strong(id, 0, std::memory_order_acq_rel);
+}
+
+void WebSocketRPC::release(Slot& slot, const Response& response)
+{
+	Callback callback = std::move(slot.callback);
+	slot.callback = nullptr;
+	--numInFlight;
+	slot.busy.store(false, std::memory_order_release);
+
+	if (callback) callback(response);
+}
+
+void WebSocketRPC::hiResTimerCallback()
+{
+	if (numInFlight.load() == 0) return;
+
+	const double now = Time::getMillisecondCounterHiRes();
+	for (int i = 0; i < maxInFlight; i++)
+	{
+		Slot& slot = slots[i];
+		const int64 id = slot.pendingId.load(std::memory_order_acquire);
+		if (id == 0) continue;
+
+		// The deadline may already be that of a later call in the slot, which only delays this check: the id won't match
+		const double deadline = slot.deadline.load(std::memory_order_relaxed);
+		if (deadline == 0 || now < deadline) continue;
+
+		if (claim(slot, id)) release(slot, Response::error(TimedOut, "Call timed out"));
+	}
+}
+
+#if JUCE_UNIT_TESTS
+
+class WebSocketRPCTests : public UnitTest
+{
+public:
+	typedef WebSocketRPC::Response Response;
+
+	WebSocketRPCTests() : UnitTest("WebSocketRPC", "SimpleWeb") {}
+
+	// Hands each message to the other side right away, so that calls complete before call() returns
+	class Loopback : public WebSocketRPC
+	{
+	public:
+		Loopback* peer = nullptr;
+
+	protected:
+		void sendText(const String& connectionId, const String& message) override { peer->handleMessage(connectionId, message); }
+	};
+
+	void runTest() override
+	{
+		Loopback caller, callee;
+		caller.peer = &callee;
+		callee.peer = &caller;
+		callee.addMethod("echo", [](const var& params, const String&) { return Response::success(params); });
+
+		const auto echo = [&](const var& params) { return caller.callFuture(String(), "echo", params).get(); };
+
+		beginTest("Round trip of params and results");
+
+		const Response number = echo(3);
+		expect(number.isOk());
+		expect(number.result.isInt());
+		expectEquals((int)number.result, 3);
+
+		const Response decimal = echo(2.5);
+		expect(decimal.result.isDouble());
+		expectEquals((double)decimal.result, 2.5);
+
+		const Response boolean = echo(true);
+		expect(boolean.result.isBool());
+		expect((bool)boolean.result);
+
+		const Response text = echo("text");
+		expect(text.result.isString());
+		expectEquals(text.result.toString(), String("text"));
+
+		const Response null = echo(var());
+		expect(null.isOk());
+		expect(null.result.isVoid());
+
+		beginTest("Errors");
+
+		expectEquals(caller.callFuture(String(), "missing", var()).get().errorCode, (int)WebSocketRPC::MethodNotFound);
+		expectEquals(caller.getNumCallsInFlight(), 0);
+	}
+};
+
+static WebSocketRPCTests webSocketRPCTests;
+
+#endif
+
+// CLIENT
+
+SimpleWebSocketClientRPC::SimpleWebSocketClientRPC(SimpleWebSocketClientBase& _client, int maxInFlight, int defaultTimeoutMs) :
+	WebSocketRPC(maxInFlight, defaultTimeoutMs),
+	client(_client)
+{
+	client.addWebSocketListener(this);
+}
+
+SimpleWebSocketClientRPC::~SimpleWebSocketClientRPC()
+{
+	client.removeWebSocketListener(this);
+}
+
+void SimpleWebSocketClientRPC::payloadReceived(const WebSocketPayload& payload)
+{
+	if (payload.isText()) handleMessage(String(), payload.getData(), payload.getSize());
+}
+
+void SimpleWebSocketClientRPC::connectionClosed(int status, const String& reason)
+{
+	cancelCalls(String(), "Connection closed : " + reason);
+}
+
+void SimpleWebSocketClientRPC::connectionError(const String& message)
+{
+	cancelCalls(String(), "Connection error : " + message);
+}
+
+void SimpleWebSocketClientRPC::sendText(const String& connectionId, const String& message)
+{
+	client.send(message);
+}
+
+// SERVER
+
+SimpleWebSocketServerRPC::SimpleWebSocketServerRPC(SimpleWebSocketServerBase& _server, int maxInFlight, int defaultTimeoutMs) :
+	WebSocketRPC(maxInFlight, defaultTimeoutMs),
+	server(_server)
+{
+	server.addWebSocketListener(this);
+}
+
+SimpleWebSocketServerRPC::~SimpleWebSocketServerRPC()
+{
+	server.removeWebSocketListener(this);
+}
+
+void SimpleWebSocketServerRPC::payloadReceived(const String& id, const WebSocketPayload& payload)
+{
+	if (payload.isText()) handleMessage(id, payload.getData(), payload.getSize());
+}
+
+void SimpleWebSocketServerRPC::connectionClosed(const String& id, int status, const String& reason)
+{
+	cancelCalls(id, "Connection closed : " + reason);
+}
+
+void SimpleWebSocketServerRPC::connectionError(const String& id, const String& message)
+{
+	cancelCalls(id, "Connection error : " + message);
+}
+
+void SimpleWebSocketServerRPC::sendText(const String& connectionId, const String& message)
+{
+	server.sendTo(message, connectionId);
+}
@@ -0,0 +1,151 @@
+/*
+  ==============================================================================
+
+	WebSocketRPC.h
+	Created: 19 Oct 2026
+
+  ==============================================================================
+*/
+
+#pragma once
+
+/// @brief JSON-RPC 2.0 requests and responses over WebSocket text messages, in both directions.
+/// Calls in flight are kept in a fixed window of slots claimed and released with atomic operations, and the request id
+/// tells which slot a response belongs to. Matching a response to its call thus takes no lock on the io thread.
+/// Calls fail with TimedOut once their deadline has passed, and with Cancelled when their connection closes.
+/// Use SimpleWebSocketClientRPC or SimpleWebSocketServerRPC to attach it to a client or a server.
+class WebSocketRPC :
+	private juce::HighResolutionTimer
+{
+public:
+	/// @brief Codes from -32000 to -32099 are left by JSON-RPC for implementations to define.
+	enum ErrorCode
+	{
+		ParseError = -32700,
+		InvalidRequest = -32600,
+		MethodNotFound = -32601,
+		InvalidParams = -32602,
+		InternalError = -32603,
+		TimedOut = -32000,
+		Cancelled = -32001,
+		WindowFull = -32002
+	};
+
+	struct Response
+	{
+		bool isOk() const { return errorCode == 0; }
+
+		juce::var result;
+		int errorCode = 0;
+		juce::String errorMessage;
+
+		static Response success(const juce::var& result) { return { result, 0, juce::String() }; }
+		static Response error(int code, const juce::String& message) { return { juce::var(), code, message }; }
+	};
+
+	typedef std::function<void(const Response&)> Callback;
+	typedef std::function<Response(const juce::var& params, const juce::String& connectionId)> Method;
+
+	/// @brief maxInFlight calls can wait for their response at once, beyond which call() fails with WindowFull.
+	WebSocketRPC(int maxInFlight = 64, int defaultTimeoutMs = 10000);
+	virtual ~WebSocketRPC();
+
+	/// @brief Methods are called on the io thread that received the request, and their Response is sent back.
+	/// Add them before requests can arrive.
+	void addMethod(const juce::String& name, Method method);
+
+	/// @brief Sends a request to the given connection, empty for a client. callback is called exactly once: on the io thread
+	/// with the response, on the deadline thread if timeoutMs passes first (-1 for the default, 0 for none), when the
+	/// connection closes, or right away if the window is full. Returns false in that last case.
+	bool call(const juce::String& connectionId, const juce::String& method, const juce::var& params, Callback callback, int timeoutMs = -1);
+	std::future<Response> callFuture(const juce::String& connectionId, const juce::String& method, const juce::var& params, int timeoutMs = -1);
+
+	/// @brief Sends a request that gets no response.
+	void notify(const juce::String& connectionId, const juce::String& method, const juce::var& params);
+
+	/// @brief Fails the calls in flight on a connection with Cancelled.
+	void cancelCalls(const juce::String& connectionId, const juce::String& reason);
+
+	/// @brief Handles a received text message. Returns false if it is not a JSON-RPC message.
+	bool handleMessage(const juce::String& connectionId, const juce::String& message);
+	bool handleMessage(const juce::String& connectionId, const char* data, size_t size);
+
+	int getNumCallsInFlight() const { return numInFlight.load(); }
+
+protected:
+	virtual void sendText(const juce::String& connectionId, const juce::String& message) = 0;
+
+private:
+	struct Slot
+	{
+		std::atomic<bool> busy { false }; // From the call that takes the slot until its callback has been moved out
+		std::atomic<juce::int64> pendingId { 0 }; // Id of the call waiting for its response, 0 once claimed. Ids are never reused
+		std::atomic<juce::int64> connectionKey { 0 }; // hashCode64 of the connection id, so that it can be compared without claiming the slot
+		std::atomic<double> deadline { 0 }; // Time::getMillisecondCounterHiRes, 0 for none
+		Callback callback; // Only touched by the call that took the slot and by whoever claimed its id
+	};
+
+	bool complete(juce::int64 id, const Response& response);
+	bool claim(Slot& slot, juce::int64 id);
+	void release(Slot& slot, const Response& response);
+	static juce::var toVar(const JSONView& value);
+	void handleRequest(const juce::String& connectionId, const juce::var& method, const juce::var& params, const juce::String& id);
+	void sendResponse(const juce::String& connectionId, const juce::String& id, const Response& response);
+	void hiResTimerCallback() override;
+
+	const int maxInFlight;
+	const int defaultTimeoutMs;
+	std::unique_ptr<Slot[]> slots;
+	std::atomic<juce::int64> lastId { 0 };
+	std::atomic<int> numInFlight { 0 };
+
+	juce::HashMap<juce::String, Method> methods;
+
+	JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(WebSocketRPC)
+};
+
+/// @brief Calls the methods of the server a client is connected to, and serves the methods it calls.
+/// RPC messages still reach the other listeners of the client.
+class SimpleWebSocketClientRPC :
+	public WebSocketRPC,
+	public SimpleWebSocketClientBase::Listener
+{
+public:
+	SimpleWebSocketClientRPC(SimpleWebSocketClientBase& client, int maxInFlight = 64, int defaultTimeoutMs = 10000);
+	~SimpleWebSocketClientRPC();
+
+	bool call(const juce::String& method, const juce::var& params, Callback callback, int timeoutMs = -1) { return WebSocketRPC::call(juce::String(), method, params, callback, timeoutMs); }
+	std::future<Response> callFuture(const juce::String& method, const juce::var& params, int timeoutMs = -1) { return WebSocketRPC::callFuture(juce::String(), method, params, timeoutMs); }
+	void notify(const juce::String& method, const juce::var& params) { WebSocketRPC::notify(juce::String(), method, params); }
+
+	void payloadReceived(const WebSocketPayload& payload) override;
+	void connectionClosed(int status, const juce::String& reason) override;
+	void connectionError(const juce::String& message) override;
+
+protected:
+	void sendText(const juce::String& connectionId, const juce::String& message) override;
+
+private:
+	SimpleWebSocketClientBase& client;
+};
+
+/// @brief Calls the methods of the clients connected to a server, by connection id, and serves the methods they call.
+/// RPC messages still reach the other listeners of the server.
+class SimpleWebSocketServerRPC :
+	public WebSocketRPC,
+	public SimpleWebSocketServerBase::Listener
+{
+public:
+	SimpleWebSocketServerRPC(SimpleWebSocketServerBase& server, int maxInFlight = 64, int defaultTimeoutMs = 10000);
+	~SimpleWebSocketServerRPC();
+
+	void payloadReceived(const juce::String& id, const WebSocketPayload& payload) override;
+	void connectionClosed(const juce::String& id, int status, const juce::String& reason) override;
+	void connectionError(const juce::String& id, const juce::String& message) override;
+
+protected:
+	void sendText(const juce::String& connectionId, const juce::String& message) override;
+
+private:
+	SimpleWebSocketServerBase& server;
+};
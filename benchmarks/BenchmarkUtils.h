@@ -0,0 +1,351 @@
+/*
+  ==============================================================================
+
+	BenchmarkUtils.h
+	Created: 19 Oct 2026
+
+	Helpers shared by the benchmarks in this folder. Each benchmark is a single
+	file with its own main(), built as a JUCE console application with
+	juce_core, juce_events, juce_cryptography and juce_simpleweb by the
+	CMakeLists.txt of this folder, which takes the path of JUCE in JUCE_DIR.
+	Results are printed as one JSON object on stdout so that runs can be compared.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <fstream>
+
+#if JUCE_LINUX || JUCE_MAC
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#if JUCE_MAC
+#include <mach/mach.h>
+#endif
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+#include "../openssl/pem.h"
+#include "../openssl/x509.h"
+#endif
+
+namespace Benchmark
+{
+	/// @brief Monotonic time in nanoseconds, comparable across threads of the process.
+	inline juce::int64 nowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/// @brief Parses "--name value" and "--flag" command line options.
+	class Options
+	{
+	public:
+		Options(int argc, char* argv[])
+		{
+			for (int i = 1; i < argc; i++)
+			{
+				juce::String arg(argv[i]);
+				if (!arg.startsWith("--")) continue;
+
+				juce::String value = "1";
+				if (i + 1 < argc && !juce::String(argv[i + 1]).startsWith("--")) value = argv[++i];
+				values.set(arg.substring(2), value);
+			}
+		}
+
+		bool has(const juce::String& name) const { return values.contains(name); }
+		juce::String getString(const juce::String& name, const juce::String& defaultValue) const { return values.contains(name) ? values[name] : defaultValue; }
+		int getInt(const juce::String& name, int defaultValue) const { return values.contains(name) ? values[name].getIntValue() : defaultValue; }
+		double getDouble(const juce::String& name, double defaultValue) const { return values.contains(name) ? values[name].getDoubleValue() : defaultValue; }
+
+	private:
+		juce::HashMap<juce::String, juce::String> values;
+	};
+
+	/// @brief Lock-free log-linear histogram of durations in nanoseconds, about 3% precision.
+	/// Can be recorded to from any number of threads.
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram() { clear(); }
+
+		void record(juce::int64 ns)
+		{
+			buckets[getBucket((juce::uint64)juce::jmax((juce::int64)0, ns))].fetch_add(1, std::memory_order_relaxed);
+		}
+
+		void clear()
+		{
+			for (auto& b : buckets) b.store(0, std::memory_order_relaxed);
+		}
+
+		juce::uint64 getCount() const
+		{
+			juce::uint64 count = 0;
+			for (auto& b : buckets) count += b.load(std::memory_order_relaxed);
+			return count;
+		}
+
+		/// @brief Value in nanoseconds below which the given fraction of the samples are (0.5 for the median).
+		double getPercentile(double fraction) const
+		{
+			juce::uint64 count = getCount();
+			if (count == 0) return 0;
+
+			juce::uint64 target = (juce::uint64)std::ceil(fraction * (double)count);
+			juce::uint64 seen = 0;
+			for (int i = 0; i < numBuckets; i++)
+			{
+				seen += buckets[i].load(std::memory_order_relaxed);
+				if (seen >= juce::jmax((juce::uint64)1, target)) return (double)getBucketValue(i);
+			}
+			return (double)getBucketValue(numBuckets - 1);
+		}
+
+		/// @brief p50, p99, p999 and max in microseconds.
+		juce::var toVar() const
+		{
+			juce::DynamicObject::Ptr o = new juce::DynamicObject();
+			o->setProperty("count", (juce::int64)getCount());
+			o->setProperty("p50_us", getPercentile(.5) / 1000.0);
+			o->setProperty("p99_us", getPercentile(.99) / 1000.0);
+			o->setProperty("p999_us", getPercentile(.999) / 1000.0);
+			o->setProperty("max_us", getPercentile(1) / 1000.0);
+			return juce::var(o.get());
+		}
+
+	private:
+		// Values under 64 have their own bucket, then each power of two is split in 32 buckets
+		static const int numBuckets = 60 * 32;
+
+		static int getBucket(juce::uint64 v)
+		{
+			if (v < 64) return (int)v;
+			int msb = 63 - __builtin_clzll(v);
+			int shift = msb - 5;
+			return (shift + 1) * 32 + (int)((v >> shift) & 31);
+		}
+
+		static juce::uint64 getBucketValue(int bucket)
+		{
+			if (bucket < 64) return (juce::uint64)bucket;
+			int shift = bucket / 32 - 1;
+			return (juce::uint64)(bucket % 32 + 32) << shift;
+		}
+
+		std::atomic<juce::uint64> buckets[numBuckets];
+	};
+
+	/// @brief Lets the process open as many sockets as the hard limit allows, for benchmarks with thousands of connections.
+	inline void raiseFileLimit()
+	{
+#if JUCE_LINUX || JUCE_MAC
+		struct rlimit limit;
+		if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+		{
+			limit.rlim_cur = limit.rlim_max;
+			setrlimit(RLIMIT_NOFILE, &limit);
+		}
+#endif
+	}
+
+	/// @brief Peak resident set size of the process in bytes, 0 where it isn't available.
+	inline juce::int64 getPeakRSS()
+	{
+#if JUCE_LINUX
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0) return (juce::int64)usage.ru_maxrss * 1024; // Kilobytes on Linux
+#elif JUCE_MAC
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0) return (juce::int64)usage.ru_maxrss; // Bytes on macOS
+#endif
+		return 0;
+	}
+
+	/// @brief Current resident set size of the process in bytes, 0 where it isn't available.
+	inline juce::int64 getCurrentRSS()
+	{
+#if JUCE_LINUX
+		std::ifstream statm("/proc/self/statm");
+		juce::int64 size = 0, resident = 0;
+		if (statm >> size >> resident) return resident * (juce::int64)sysconf(_SC_PAGESIZE);
+#elif JUCE_MAC
+		mach_task_basic_info info;
+		mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+		if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) == KERN_SUCCESS) return (juce::int64)info.resident_size;
+#endif
+		return 0;
+	}
+
+	/// @brief User and system CPU time used by the process so far, in seconds.
+	inline double getProcessCPUSeconds()
+	{
+#if JUCE_LINUX || JUCE_MAC
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+			return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+#endif
+		return 0;
+	}
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+	/// @brief Writes a self-signed certificate for localhost and its private key as PEM files, valid for one day.
+	/// Uses an ECDSA P-256 key if useEC is true, else an RSA 2048 key.
+	inline bool createSelfSignedCertificate(const juce::File& certFile, const juce::File& keyFile, bool useEC)
+	{
+		EVP_PKEY* key = nullptr;
+		EVP_PKEY_CTX* keyContext = EVP_PKEY_CTX_new_id(useEC ? EVP_PKEY_EC : EVP_PKEY_RSA, nullptr);
+		bool ok = keyContext != nullptr && EVP_PKEY_keygen_init(keyContext) > 0
+			&& (useEC ? EVP_PKEY_CTX_set_ec_paramgen_curve_nid(keyContext, NID_X9_62_prime256v1) : EVP_PKEY_CTX_set_rsa_keygen_bits(keyContext, 2048)) > 0
+			&& EVP_PKEY_keygen(keyContext, &key) > 0;
+		EVP_PKEY_CTX_free(keyContext);
+		if (!ok) return false;
+
+		X509* cert = X509_new();
+		X509_set_version(cert, 2);
+		ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+		X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+		X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+		X509_set_pubkey(cert, key);
+
+		X509_NAME* name = X509_get_subject_name(cert);
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+		X509_set_issuer_name(cert, name);
+		ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+		if (ok)
+		{
+			BIO* certBio = BIO_new_file(certFile.getFullPathName().toRawUTF8(), "w");
+			BIO* keyBio = BIO_new_file(keyFile.getFullPathName().toRawUTF8(), "w");
+			ok = certBio != nullptr && keyBio != nullptr
+				&& PEM_write_bio_X509(certBio, cert) > 0
+				&& PEM_write_bio_PrivateKey(keyBio, key, nullptr, nullptr, 0, nullptr, nullptr) > 0;
+			BIO_free(certBio);
+			BIO_free(keyBio);
+		}
+
+		X509_free(cert);
+		EVP_PKEY_free(key);
+		return ok;
+	}
+#endif
+
+	/// @brief Runs an io_context on the given number of threads until stop() is called.
+	class IOThreads
+	{
+	public:
+		IOThreads(int numThreads) :
+			ioService(std::make_shared<asio::io_service>()),
+			work(new asio::io_service::work(*ioService))
+		{
+			for (int i = 0; i < juce::jmax(1, numThreads); i++) threads.emplace_back([this]() { ioService->run(); });
+		}
+
+		~IOThreads() { stop(); }
+
+		void stop()
+		{
+			work.reset();
+			ioService->stop();
+			for (auto& t : threads) if (t.joinable()) t.join();
+		}
+
+		std::shared_ptr<asio::io_service> ioService;
+
+	private:
+		std::unique_ptr<asio::io_service::work> work;
+		std::vector<std::thread> threads;
+	};
+
+	inline void printResult(const juce::var& result)
+	{
+		std::cout << juce::JSON::toString(result, true).toStdString() << std::endl;
+	}
+
+	/// @brief Keeps the compiler from optimising away a value computed by a micro benchmark.
+	template <typename T>
+	inline void doNotOptimize(const T& value)
+	{
+#if defined(__GNUC__) || defined(__clang__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile const void* sink;
+		sink = &value;
+#endif
+	}
+
+	/// @brief Runs micro benchmarks in the manner of Google Benchmark: each case is called with a number of
+	/// iterations that doubles until a run takes at least --min_time seconds, and the median of --repetitions
+	/// such runs is reported in nanoseconds per iteration. Cases can be selected with --filter substring.
+	class MicroBenchmarks
+	{
+	public:
+		/// @brief run(iterations) must do the measured work exactly iterations times.
+		/// bytesPerIteration is used to report a throughput, 0 if it doesn't apply.
+		void add(const juce::String& name, size_t bytesPerIteration, std::function<void(juce::uint64 iterations)> run)
+		{
+			cases.push_back({ name, bytesPerIteration, std::move(run) });
+		}
+
+		juce::var run(const Options& options) const
+		{
+			const juce::String filter = options.getString("filter", "");
+			const double minTime = juce::jmax(.001, options.getDouble("min_time", .2));
+			const int repetitions = juce::jmax(1, options.getInt("repetitions", 3));
+
+			juce::Array<juce::var> results;
+			for (auto& c : cases)
+			{
+				if (filter.isNotEmpty() && !c.name.contains(filter)) continue;
+
+				juce::uint64 iterations = 1;
+				double seconds = measure(c, iterations);
+				while (seconds < minTime && iterations < ((juce::uint64)1 << 40))
+				{
+					// Aim a bit past minTime so that one more doubling is rarely needed
+					double factor = seconds > 0 ? juce::jlimit(2.0, 100.0, 1.4 * minTime / seconds) : 100.0;
+					iterations = (juce::uint64)((double)iterations * factor);
+					seconds = measure(c, iterations);
+				}
+
+				std::vector<double> nsPerIteration { seconds * 1e9 / (double)iterations };
+				for (int r = 1; r < repetitions; r++) nsPerIteration.push_back(measure(c, iterations) * 1e9 / (double)iterations);
+				std::sort(nsPerIteration.begin(), nsPerIteration.end());
+				const double median = nsPerIteration[nsPerIteration.size() / 2];
+
+				juce::DynamicObject::Ptr o = new juce::DynamicObject();
+				o->setProperty("name", c.name);
+				o->setProperty("iterations", (juce::int64)iterations);
+				o->setProperty("ns_per_op", median);
+				o->setProperty("ns_per_op_min", nsPerIteration.front());
+				if (c.bytesPerIteration > 0) o->setProperty("mb_per_s", (double)c.bytesPerIteration / median * 1e9 / (1024.0 * 1024.0));
+				results.add(juce::var(o.get()));
+
+				std::cerr << c.name << ": " << median << " ns/op" << std::endl;
+			}
+			return juce::var(results);
+		}
+
+	private:
+		struct Case
+		{
+			juce::String name;
+			size_t bytesPerIteration;
+			std::function<void(juce::uint64)> run;
+		};
+
+		static double measure(const Case& c, juce::uint64 iterations)
+		{
+			const juce::int64 start = nowNs();
+			c.run(iterations);
+			return (nowNs() - start) / 1e9;
+		}
+
+		std::vector<Case> cases;
+	};
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+	ConnectionStormBenchmark.cpp
+	Created: 19 Oct 2026
+
+	Simulates the reconnect storm that follows a network outage. All the clients
+	connect at once to a SimpleWebSocketServer, and then to a SecureWebSocketServer
+	using a self-signed certificate generated at startup. Once every client is
+	open or has failed, they are all closed and the next round starts.
+	The secure storm is run twice: with a context per client, so every handshake
+	is a full one, and with a context shared by all the clients, so that rounds
+	after the first resume the TLS sessions of the previous ones.
+
+	Reported for each server:
+		handshakes_per_s          successful WebSocket opens per second over all rounds
+		reconnect_ms              time for a round of clients to be all open (p50 and max over rounds)
+		failed                    clients that could not open
+		resumed                   opens that resumed a TLS session
+		listen_overflows          increase of TcpExt ListenOverflows (Linux only, -1 elsewhere)
+		cpu_us_per_handshake      process CPU time per successful open, client and server sides together
+	The TLS share of the handshake cost is estimated from the difference between
+	the two servers, since the WebSocket upgrade (write_handshake) is the same.
+
+	Options:
+		--clients N       clients per round (default 1000)
+		--rounds R        storm rounds per server (default 5)
+		--threads T       client io threads (default 4)
+		--key K           rsa or ec, for the certificate key (default rsa)
+		--timeout S       seconds to wait for a round to complete (default 30)
+		--port P          base server port, WSS uses P + 1 (default 9982)
+
+  ==============================================================================
+*/
+
+#include "BenchmarkUtils.h"
+
+using namespace juce;
+
+namespace
+{
+	/// Reads TcpExt ListenOverflows from /proc/net/netstat, the number of connections dropped because an accept queue was full
+	int64 getListenOverflows()
+	{
+#if JUCE_LINUX
+		std::ifstream netstat("/proc/net/netstat");
+		std::string names, values;
+		while (std::getline(netstat, names) && std::getline(netstat, values))
+		{
+			if (names.compare(0, 7, "TcpExt:") != 0) continue;
+
+			StringArray n = StringArray::fromTokens(String(names), " ", "");
+			StringArray v = StringArray::fromTokens(String(values), " ", "");
+			int index = n.indexOf("ListenOverflows");
+			if (index >= 0 && index < v.size()) return v[index].getLargeIntValue();
+		}
+#endif
+		return -1;
+	}
+
+	bool isResumed(SimpleWeb::WS&) { return false; }
+#if SIMPLEWEB_SECURE_SUPPORTED
+	bool isResumed(SimpleWeb::WSS& socket) { return SSL_session_reused(socket.native_handle()) == 1; }
+#endif
+
+	template <class ClientType>
+	var runStorm(const String& name, std::function<ClientType*()> createClient, int numClients, int numRounds, int numThreads, double timeout)
+	{
+		Benchmark::IOThreads io(numThreads);
+		std::vector<double> roundMs;
+		int64 numOpened = 0, numFailed = 0, numResumed = 0;
+		double stormSeconds = 0;
+
+		const int64 overflowsBefore = getListenOverflows();
+		const double cpuBefore = Benchmark::getProcessCPUSeconds();
+
+		for (int round = 0; round < numRounds; round++)
+		{
+			std::atomic<int> opened { 0 }, failed { 0 }, resumed { 0 };
+			std::vector<std::unique_ptr<ClientType>> clients;
+			clients.reserve((size_t)numClients);
+
+			const int64 startNs = Benchmark::nowNs();
+			for (int i = 0; i < numClients; i++)
+			{
+				std::unique_ptr<ClientType> client(createClient());
+				client->io_service = io.ioService;
+				client->config.timeout_request = (long)timeout;
+				client->on_open = [&opened, &resumed](std::shared_ptr<typename ClientType::Connection> connection)
+					{
+						if (isResumed(*connection->get_socket())) resumed++;
+						opened++;
+					};
+				client->on_error = [&failed](std::shared_ptr<typename ClientType::Connection>, const SimpleWeb::error_code&) { failed++; };
+				client->start();
+				clients.push_back(std::move(client));
+			}
+
+			const int64 deadlineNs = startNs + (int64)(timeout * 1e9);
+			while (opened + failed < numClients && Benchmark::nowNs() < deadlineNs) Thread::sleep(1);
+			const double ms = (Benchmark::nowNs() - startNs) / 1e6;
+
+			roundMs.push_back(ms);
+			stormSeconds += ms / 1000.0;
+			numOpened += opened;
+			numFailed += numClients - opened;
+			numResumed += resumed;
+
+			for (auto& c : clients) c->stop();
+			Thread::sleep(200); // Let the server reap the closed connections before the next storm
+		}
+
+		const double cpu = Benchmark::getProcessCPUSeconds() - cpuBefore;
+		const int64 overflowsAfter = getListenOverflows();
+		io.stop();
+
+		std::sort(roundMs.begin(), roundMs.end());
+
+		DynamicObject::Ptr reconnect = new DynamicObject();
+		reconnect->setProperty("p50_ms", roundMs[roundMs.size() / 2]);
+		reconnect->setProperty("max_ms", roundMs.back());
+
+		DynamicObject::Ptr result = new DynamicObject();
+		result->setProperty("server", name);
+		result->setProperty("opened", numOpened);
+		result->setProperty("failed", numFailed);
+		result->setProperty("resumed", numResumed);
+		result->setProperty("handshakes_per_s", numOpened / jmax(1e-9, stormSeconds));
+		result->setProperty("reconnect", var(reconnect.get()));
+		result->setProperty("listen_overflows", overflowsBefore >= 0 && overflowsAfter >= 0 ? overflowsAfter - overflowsBefore : (int64)-1);
+		result->setProperty("cpu_us_per_handshake", numOpened > 0 ? cpu * 1e6 / (double)numOpened : 0.0);
+		return var(result.get());
+	}
+
+	template <class ServerType>
+	bool waitForServer(ServerType& server, int port)
+	{
+		for (int i = 0; i < 500 && !server.isConnected; i++) Thread::sleep(10);
+		if (!server.isConnected) std::cerr << "Could not start server on port " << port << std::endl;
+		return server.isConnected;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options(argc, argv);
+	const int numClients = jlimit(1, 100000, options.getInt("clients", 1000));
+	const int numRounds = jmax(1, options.getInt("rounds", 5));
+	const int numThreads = options.getInt("threads", 4);
+	const double timeout = jmax(1.0, options.getDouble("timeout", 30));
+	const int port = options.getInt("port", 9982);
+
+	Benchmark::raiseFileLimit();
+
+	Array<var> results;
+
+	{
+		SimpleWebSocketServer server;
+		server.start(port, "", "127.0.0.1", true);
+		if (!waitForServer(server, port)) return 1;
+
+		const std::string url = "127.0.0.1:" + std::to_string(port) + "/";
+		results.add(runStorm<WsClient>("ws", [url]() { return new WsClient(url); }, numClients, numRounds, numThreads, timeout));
+		server.stop();
+	}
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+	{
+		const bool useEC = options.getString("key", "rsa") == "ec";
+		File dir = File::getSpecialLocation(File::tempDirectory).getChildFile("simpleweb_storm_benchmark");
+		dir.createDirectory();
+		File certFile = dir.getChildFile("cert.pem"), keyFile = dir.getChildFile("key.pem");
+		if (!Benchmark::createSelfSignedCertificate(certFile, keyFile, useEC))
+		{
+			std::cerr << "Could not create a self-signed certificate" << std::endl;
+			return 1;
+		}
+
+		SecureWebSocketServer server(certFile.getFullPathName(), keyFile.getFullPathName());
+		server.start(port + 1, "", "127.0.0.1", true);
+		if (!waitForServer(server, port + 1)) return 1;
+
+		const std::string url = "127.0.0.1:" + std::to_string(port + 1) + "/";
+		results.add(runStorm<WssClient>("wss", [url]() { return new WssClient(url, false); }, numClients, numRounds, numThreads, timeout));
+
+		auto context = WssClient::make_context(false);
+		results.add(runStorm<WssClient>("wss_resumed", [url, context]() { return new WssClient(url, context); }, numClients, numRounds, numThreads, timeout));
+		server.stop();
+		dir.deleteRecursively();
+	}
+#endif
+
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("benchmark", "connection_storm");
+	result->setProperty("clients", numClients);
+	result->setProperty("rounds", numRounds);
+	result->setProperty("results", var(results));
+
+	if (results.size() >= 2)
+	{
+		const double wsCpu = results[0]["cpu_us_per_handshake"], wssCpu = results[1]["cpu_us_per_handshake"];
+		if (wssCpu > 0) result->setProperty("tls_cpu_share", jlimit(0.0, 1.0, (wssCpu - wsCpu) / wssCpu));
+	}
+
+	Benchmark::printResult(var(result.get()));
+	return 0;
+}
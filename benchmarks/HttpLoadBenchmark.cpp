@@ -0,0 +1,274 @@
+/*
+  ==============================================================================
+
+	HttpLoadBenchmark.cpp
+	Created: 19 Oct 2026
+
+	Starts a SimpleWebSocketServer on loopback and drives its HTTP server through
+	httpDefaultCallback with keep-alive connections, each sending its next request
+	as soon as the previous response is complete. Three scenarios are measured:
+		small   small text files served from rootPath
+		large   one large binary file served from rootPath
+		api     a trivial RequestHandler route answering a short JSON body
+	For each one it reports requests/s, throughput, latency percentiles and the
+	peak RSS of the process so far, which includes the client side.
+
+	Options:
+		--scenario S      small, large, api or all (default all)
+		--connections N   keep-alive connections (default 64)
+		--duration S      seconds per scenario (default 10)
+		--threads T       client io threads (default 2)
+		--small_files N   number of small files (default 100)
+		--large_size B    size of the large file in bytes (default 4194304)
+		--port P          server port (default 9981)
+
+  ==============================================================================
+*/
+
+#include "BenchmarkUtils.h"
+
+using namespace juce;
+
+namespace
+{
+	class ApiHandler :
+		public SimpleWebSocketServerBase::RequestHandler
+	{
+	public:
+		bool handleHTTPRequest(std::shared_ptr<HttpServer::Response> response, std::shared_ptr<HttpServer::Request> request) override
+		{
+			if (request->path != "/api/status") return false;
+
+			SimpleWeb::CaseInsensitiveMultimap header;
+			header.emplace("Content-Type", "application/json");
+			response->write(SimpleWeb::StatusCode::success_ok, "{\"status\":\"ok\",\"uptime\":12345,\"clients\":3}", header);
+			return true;
+		}
+	};
+
+	struct Stats
+	{
+		Benchmark::LatencyHistogram latency;
+		std::atomic<uint64> numRequests { 0 };
+		std::atomic<uint64> numErrors { 0 };
+		std::atomic<uint64> bytesReceived { 0 };
+	};
+
+	/// One keep-alive connection sending GET requests for the given paths in turn, one at a time
+	class LoadConnection :
+		public std::enable_shared_from_this<LoadConnection>
+	{
+	public:
+		LoadConnection(asio::io_service& ioService, const asio::ip::tcp::endpoint& endpoint, std::vector<std::string> paths, Stats& stats, const std::atomic<bool>& running) :
+			socket(ioService), endpoint(endpoint), paths(std::move(paths)), stats(stats), running(running)
+		{
+		}
+
+		void start()
+		{
+			auto self = shared_from_this();
+			socket.async_connect(endpoint, [self](const SimpleWeb::error_code& ec)
+				{
+					if (self->failed(ec)) return;
+					self->socket.set_option(asio::ip::tcp::no_delay(true));
+					self->sendRequest();
+				});
+		}
+
+		void close()
+		{
+			SimpleWeb::error_code ec;
+			socket.close(ec);
+		}
+
+	private:
+		/// Errors from closing the connections at the end of the scenario are not counted
+		bool failed(const SimpleWeb::error_code& ec)
+		{
+			if (!ec) return false;
+			if (running) stats.numErrors++;
+			return true;
+		}
+
+		void sendRequest()
+		{
+			if (!running) return;
+
+			request = "GET " + paths[nextPath++ % paths.size()] + " HTTP/1.1\r\nHost: 127.0.0.1\r\nAccept: */*\r\n\r\n";
+			startNs = Benchmark::nowNs();
+
+			auto self = shared_from_this();
+			asio::async_write(socket, asio::buffer(request), [self](const SimpleWeb::error_code& ec, size_t)
+				{
+					if (self->failed(ec)) return;
+					self->readHeader();
+				});
+		}
+
+		void readHeader()
+		{
+			auto self = shared_from_this();
+			asio::async_read_until(socket, buffer, "\r\n\r\n", [self](const SimpleWeb::error_code& ec, size_t headerSize)
+				{
+					if (self->failed(ec)) return;
+
+					std::string header(asio::buffers_begin(self->buffer.data()), asio::buffers_begin(self->buffer.data()) + headerSize);
+					self->buffer.consume(headerSize);
+
+					if (header.compare(0, 12, "HTTP/1.1 200") != 0) self->stats.numErrors++;
+
+					size_t contentLength = 0;
+					String h(header);
+					int index = h.indexOfIgnoreCase("\r\nContent-Length:");
+					if (index >= 0) contentLength = (size_t)h.substring(index + 17).trim().getLargeIntValue();
+
+					self->stats.bytesReceived.fetch_add(headerSize + contentLength, std::memory_order_relaxed);
+					self->readBody(contentLength);
+				});
+		}
+
+		void readBody(size_t contentLength)
+		{
+			if (buffer.size() >= contentLength)
+			{
+				buffer.consume(contentLength);
+				complete();
+				return;
+			}
+
+			auto self = shared_from_this();
+			asio::async_read(socket, buffer, asio::transfer_exactly(contentLength - buffer.size()), [self, contentLength](const SimpleWeb::error_code& ec, size_t)
+				{
+					if (self->failed(ec)) return;
+					self->buffer.consume(contentLength);
+					self->complete();
+				});
+		}
+
+		void complete()
+		{
+			stats.latency.record(Benchmark::nowNs() - startNs);
+			stats.numRequests.fetch_add(1, std::memory_order_relaxed);
+			sendRequest();
+		}
+
+		asio::ip::tcp::socket socket;
+		asio::ip::tcp::endpoint endpoint;
+		std::vector<std::string> paths;
+		Stats& stats;
+		const std::atomic<bool>& running;
+
+		size_t nextPath = 0;
+		std::string request;
+		asio::streambuf buffer;
+		int64 startNs = 0;
+	};
+
+	var runScenario(const String& name, const std::vector<std::string>& paths, int port, int numConnections, int numThreads, double duration)
+	{
+		Stats stats;
+		std::atomic<bool> running { true };
+
+		const int64 startNs = Benchmark::nowNs();
+		{
+			Benchmark::IOThreads io(numThreads);
+			std::vector<std::shared_ptr<LoadConnection>> connections;
+			asio::ip::tcp::endpoint endpoint(asio::ip::address::from_string("127.0.0.1"), (unsigned short)port);
+
+			for (int i = 0; i < numConnections; i++)
+			{
+				// Start each connection at a different path so that all the files are requested at once
+				std::vector<std::string> rotated(paths.begin() + (i % paths.size()), paths.end());
+				rotated.insert(rotated.end(), paths.begin(), paths.begin() + (i % paths.size()));
+
+				connections.push_back(std::make_shared<LoadConnection>(*io.ioService, endpoint, rotated, stats, running));
+				connections.back()->start();
+			}
+
+			std::this_thread::sleep_for(std::chrono::microseconds((int64)(duration * 1e6)));
+			running = false;
+
+			io.stop();
+			for (auto& c : connections) c->close();
+		}
+		const double elapsed = (Benchmark::nowNs() - startNs) / 1e9;
+
+		DynamicObject::Ptr result = new DynamicObject();
+		result->setProperty("scenario", name);
+		result->setProperty("duration_s", elapsed);
+		result->setProperty("requests", (int64)stats.numRequests.load());
+		result->setProperty("errors", (int64)stats.numErrors.load());
+		result->setProperty("requests_per_s", stats.numRequests.load() / elapsed);
+		result->setProperty("mb_per_s", stats.bytesReceived.load() / elapsed / (1024.0 * 1024.0));
+		result->setProperty("latency", stats.latency.toVar());
+		result->setProperty("peak_rss_mb", Benchmark::getPeakRSS() / (1024.0 * 1024.0));
+		return var(result.get());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options(argc, argv);
+	const String scenario = options.getString("scenario", "all");
+	const int numConnections = jlimit(1, 100000, options.getInt("connections", 64));
+	const double duration = jmax(.1, options.getDouble("duration", 10));
+	const int numThreads = options.getInt("threads", 2);
+	const int numSmallFiles = jmax(1, options.getInt("small_files", 100));
+	const int64 largeSize = jmax((int64)1, (int64)options.getDouble("large_size", 4 * 1024 * 1024));
+	const int port = options.getInt("port", 9981);
+
+	Benchmark::raiseFileLimit();
+
+	// Small pages and assets between 512 bytes and 16 KB, and one large binary file
+	File root = File::getSpecialLocation(File::tempDirectory).getChildFile("simpleweb_http_benchmark");
+	root.deleteRecursively();
+	root.createDirectory();
+
+	const char* extensions[] = { "html", "css", "js", "json" };
+	std::vector<std::string> smallPaths;
+	Random random(1);
+	for (int i = 0; i < numSmallFiles; i++)
+	{
+		String name = "small/file" + String(i) + "." + extensions[i % 4];
+		File f = root.getChildFile(name);
+		f.getParentDirectory().createDirectory();
+		f.replaceWithText(String::repeatedString("lorem ipsum dolor sit amet ", 512).substring(0, 512 + random.nextInt(16 * 1024 - 512)));
+		smallPaths.push_back("/" + name.toStdString());
+	}
+
+	{
+		MemoryBlock large((size_t)largeSize);
+		for (size_t i = 0; i < large.getSize(); i++) large[i] = (char)(i * 31);
+		root.getChildFile("large.bin").replaceWithData(large.getData(), large.getSize());
+	}
+
+	SimpleWebSocketServer server;
+	ApiHandler apiHandler;
+	server.rootPath = root;
+	server.addHTTPRequestHandler(&apiHandler);
+	server.start(port, "", "127.0.0.1", true);
+	for (int i = 0; i < 500 && !server.isConnected; i++) Thread::sleep(10);
+	if (!server.isConnected)
+	{
+		std::cerr << "Could not start server on port " << port << std::endl;
+		return 1;
+	}
+
+	Array<var> results;
+	if (scenario == "all" || scenario == "small") results.add(runScenario("small", smallPaths, port, numConnections, numThreads, duration));
+	if (scenario == "all" || scenario == "large") results.add(runScenario("large", { "/large.bin" }, port, numConnections, numThreads, duration));
+	if (scenario == "all" || scenario == "api") results.add(runScenario("api", { "/api/status" }, port, numConnections, numThreads, duration));
+
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("benchmark", "http_load");
+	result->setProperty("connections", numConnections);
+	result->setProperty("small_files", numSmallFiles);
+	result->setProperty("large_bytes", largeSize);
+	result->setProperty("results", var(results));
+	Benchmark::printResult(var(result.get()));
+
+	server.removeHTTPRequestHandler(&apiHandler);
+	server.stop();
+	root.deleteRecursively();
+	return 0;
+}
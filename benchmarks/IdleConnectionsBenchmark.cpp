@@ -0,0 +1,259 @@
+/*
+  ==============================================================================
+
+	IdleConnectionsBenchmark.cpp
+	Created: 19 Oct 2026
+
+	Measures the memory a server holds per idle WebSocket connection. The server
+	runs in this process. The clients run in a child process, started from the
+	same executable with --role clients, so that their memory isn't counted.
+	Each client is a bare socket that performs the upgrade and then stays
+	silent. Once they are all connected, the growth of the server's resident set
+	is divided by the number of connections.
+
+	There are only about 28k ephemeral ports per destination address, so the
+	clients spread over 127.0.0.1, 127.0.0.2... and the server listens on all
+	addresses when more than one is needed.
+
+	Options:
+		--clients N        idle connections (default 100000)
+		--low_footprint B  1 to enable SimpleWebSocketServerBase::lowFootprint (default 1)
+		--wss              use SecureWebSocketServer with a self-signed certificate
+		--concurrency C    connections being opened at the same time (default 256)
+		--port P           server port (default 9983)
+
+  ==============================================================================
+*/
+
+#include "BenchmarkUtils.h"
+
+using namespace juce;
+
+namespace
+{
+	const int clientsPerAddress = 20000;
+
+	/// Opens connections with at most maxInFlight handshakes at once, keeping each socket once it is upgraded
+	template <class SocketType>
+	class IdleClients
+	{
+	public:
+		IdleClients(asio::io_service& ioService, std::function<std::unique_ptr<SocketType>(asio::io_service&)> createSocket, int port, int numClients, int maxInFlight) :
+			ioService(ioService), createSocket(std::move(createSocket)), port(port), numClients(numClients), maxInFlight(maxInFlight)
+		{
+		}
+
+		void start()
+		{
+			for (int i = 0; i < maxInFlight; i++) openNext();
+		}
+
+		bool isDone() const { return numConnected + numFailed >= numClients; }
+
+		std::atomic<int> numConnected { 0 };
+		std::atomic<int> numFailed { 0 };
+
+	private:
+		struct Client
+		{
+			std::unique_ptr<SocketType> socket;
+			std::string request;
+			asio::streambuf response;
+		};
+
+		void openNext()
+		{
+			int index = numStarted++;
+			if (index >= numClients) return;
+
+			auto client = std::make_shared<Client>();
+			client->socket = createSocket(ioService);
+
+			auto address = asio::ip::address_v4((127u << 24) + 1 + (unsigned)(index / clientsPerAddress));
+			client->request = "GET / HTTP/1.1\r\nHost: " + address.to_string() + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+				"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+			client->socket->lowest_layer().async_connect(asio::ip::tcp::endpoint(address, (unsigned short)port), [this, client](const SimpleWeb::error_code& ec)
+				{
+					if (ec) return fail();
+					handshake(client);
+				});
+		}
+
+		void handshake(std::shared_ptr<Client> client);
+
+		void upgrade(std::shared_ptr<Client> client)
+		{
+			asio::async_write(*client->socket, asio::buffer(client->request), [this, client](const SimpleWeb::error_code& ec, size_t)
+				{
+					if (ec) return fail();
+					asio::async_read_until(*client->socket, client->response, "\r\n\r\n", [this, client](const SimpleWeb::error_code& ec, size_t)
+						{
+							if (ec) return fail();
+
+							std::string status(asio::buffers_begin(client->response.data()), asio::buffers_begin(client->response.data()) + 12);
+							if (status != "HTTP/1.1 101") return fail();
+
+							sockets.push_back(std::move(client->socket));
+							numConnected++;
+							openNext();
+						});
+				});
+		}
+
+		void fail()
+		{
+			numFailed++;
+			openNext();
+		}
+
+		asio::io_service& ioService;
+		std::function<std::unique_ptr<SocketType>(asio::io_service&)> createSocket;
+		const int port, numClients, maxInFlight;
+		std::atomic<int> numStarted { 0 };
+		std::vector<std::unique_ptr<SocketType>> sockets; // Only touched from the single io thread, see runClients
+	};
+
+	template <>
+	void IdleClients<asio::ip::tcp::socket>::handshake(std::shared_ptr<Client> client)
+	{
+		upgrade(client);
+	}
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+	template <>
+	void IdleClients<asio::ssl::stream<asio::ip::tcp::socket>>::handshake(std::shared_ptr<Client> client)
+	{
+		client->socket->async_handshake(asio::ssl::stream_base::client, [this, client](const SimpleWeb::error_code& ec)
+			{
+				if (ec) return fail();
+				upgrade(client);
+			});
+	}
+#endif
+
+	template <class SocketType>
+	int runClients(std::function<std::unique_ptr<SocketType>(asio::io_service&)> createSocket, const Benchmark::Options& options)
+	{
+		// A single io thread, so that the socket list needs no locking. Connecting is not what is measured.
+		Benchmark::IOThreads io(1);
+		IdleClients<SocketType> clients(*io.ioService, createSocket, options.getInt("port", 9983), options.getInt("clients", 100000), jmax(1, options.getInt("concurrency", 256)));
+		SimpleWeb::post(*io.ioService, [&clients]() { clients.start(); });
+
+		while (!clients.isDone()) Thread::sleep(10);
+		std::cout << "connected " << clients.numConnected << " failed " << clients.numFailed << std::endl;
+
+		// Stay connected until the server process has measured its memory and kills this one
+		for (;;) Thread::sleep(1000);
+	}
+
+	/// Reads the first line of the child process output, which reports the number of connected clients.
+	/// Reads one byte at a time, since readProcessOutput blocks until the requested size is read.
+	int waitForClients(ChildProcess& child)
+	{
+		String output;
+		char c;
+		while (child.readProcessOutput(&c, 1) == 1 && c != '\n') output += c;
+
+		std::cerr << output << std::endl;
+		if (!output.startsWith("connected ")) return -1;
+		return output.fromFirstOccurrenceOf("connected ", false, false).getIntValue();
+	}
+
+	template <class ServerType>
+	var measureServer(ServerType& server, const Benchmark::Options& options, const StringArray& childArgs, int numClients, int port)
+	{
+		server.lowFootprint = options.getInt("low_footprint", 1) != 0;
+		server.start(port, "", numClients > clientsPerAddress ? "" : "127.0.0.1", true);
+		for (int i = 0; i < 500 && !server.isConnected; i++) Thread::sleep(10);
+		if (!server.isConnected) return var();
+
+		Thread::sleep(500);
+		const int64 rssBefore = Benchmark::getCurrentRSS();
+
+		ChildProcess child;
+		if (!child.start(childArgs, ChildProcess::wantStdOut)) return var();
+
+		const int connected = waitForClients(child);
+		Thread::sleep(2000); // Let the last handshakes finish on the server side
+		const int64 rssAfter = Benchmark::getCurrentRSS();
+		const int serverConnections = server.getNumActiveConnections();
+
+		child.kill();
+		server.stop();
+
+		DynamicObject::Ptr result = new DynamicObject();
+		result->setProperty("connected", connected);
+		result->setProperty("server_connections", serverConnections);
+		result->setProperty("rss_before_mb", rssBefore / (1024.0 * 1024.0));
+		result->setProperty("rss_after_mb", rssAfter / (1024.0 * 1024.0));
+		result->setProperty("bytes_per_connection", serverConnections > 0 ? (double)(rssAfter - rssBefore) / serverConnections : 0.0);
+		return var(result.get());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options(argc, argv);
+	const int numClients = jlimit(1, 1000000, options.getInt("clients", 100000));
+	const bool useWSS = options.has("wss");
+	const int port = options.getInt("port", 9983);
+
+	Benchmark::raiseFileLimit();
+
+	if (options.getString("role", "") == "clients")
+	{
+		if (!useWSS)
+			return runClients<asio::ip::tcp::socket>([](asio::io_service& ioService) { return std::unique_ptr<asio::ip::tcp::socket>(new asio::ip::tcp::socket(ioService)); }, options);
+
+#if SIMPLEWEB_SECURE_SUPPORTED
+		asio::ssl::context context(asio::ssl::context::tlsv12);
+		using SSLSocket = asio::ssl::stream<asio::ip::tcp::socket>;
+		return runClients<SSLSocket>([&context](asio::io_service& ioService) { return std::unique_ptr<SSLSocket>(new SSLSocket(ioService, context)); }, options);
+#else
+		return 1;
+#endif
+	}
+
+	StringArray childArgs;
+	childArgs.add(File::getSpecialLocation(File::currentExecutableFile).getFullPathName());
+	for (int i = 1; i < argc; i++) childArgs.add(argv[i]);
+	childArgs.add("--role");
+	childArgs.add("clients");
+
+	var measurement;
+	if (!useWSS)
+	{
+		SimpleWebSocketServer server;
+		measurement = measureServer(server, options, childArgs, numClients, port);
+	}
+#if SIMPLEWEB_SECURE_SUPPORTED
+	else
+	{
+		File dir = File::getSpecialLocation(File::tempDirectory).getChildFile("simpleweb_idle_benchmark");
+		dir.createDirectory();
+		File certFile = dir.getChildFile("cert.pem"), keyFile = dir.getChildFile("key.pem");
+		if (Benchmark::createSelfSignedCertificate(certFile, keyFile, true))
+		{
+			SecureWebSocketServer server(certFile.getFullPathName(), keyFile.getFullPathName());
+			measurement = measureServer(server, options, childArgs, numClients, port);
+		}
+		dir.deleteRecursively();
+	}
+#endif
+
+	if (measurement.isVoid())
+	{
+		std::cerr << "Could not run the benchmark on port " << port << std::endl;
+		return 1;
+	}
+
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("benchmark", "idle_connections");
+	result->setProperty("server", useWSS ? "wss" : "ws");
+	result->setProperty("low_footprint", options.getInt("low_footprint", 1) != 0);
+	result->setProperty("clients", numClients);
+	result->setProperty("result", measurement);
+	Benchmark::printResult(var(result.get()));
+	return 0;
+}
@@ -0,0 +1,355 @@
+/*
+  ==============================================================================
+
+	MicroBenchmarks.cpp
+	Created: 19 Oct 2026
+
+	Measures the hot primitives of the servers and the client in isolation, over
+	inputs shaped like real traffic, so that a regression or a faster kernel in
+	one of them shows up without network noise:
+		- server unmasking of a client frame, as done in read_message_content
+		- client masking and framing, as done in Connection::send
+		- RequestMessage::parse and HttpHeader::parse
+		- CaseInsensitiveHash on header names
+		- Percent::decode on paths, query strings and form values
+		- WSCrypto::calcSha1 and base64_encode, as in the WebSocket handshake
+		- MessagePack::write and parse against JSON::toString and parse, on a var
+		  shaped like the state a controller streams at 60 Hz
+
+	Options:
+		--filter S        only run the cases whose name contains S
+		--min_time T      minimum seconds per measurement (default 0.2)
+		--repetitions N   measurements per case, the median is reported (default 3)
+
+  ==============================================================================
+*/
+
+#include "BenchmarkUtils.h"
+
+using namespace juce;
+
+namespace
+{
+	/// Reads a string in place, so that parsing benchmarks don't measure a copy into a std::istringstream
+	class MemoryStreamBuffer : public std::streambuf
+	{
+	public:
+		void reset(const std::string& s)
+		{
+			char* begin = const_cast<char*>(s.data());
+			setg(begin, begin, begin + s.size());
+		}
+	};
+
+	const std::vector<std::string> requestCorpus = {
+		// Browser navigation
+		"GET /dashboard/index.html HTTP/1.1\r\n"
+		"Host: 192.168.1.20:8080\r\n"
+		"Connection: keep-alive\r\n"
+		"Cache-Control: max-age=0\r\n"
+		"Upgrade-Insecure-Requests: 1\r\n"
+		"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+		"Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,*/*;q=0.8\r\n"
+		"Accept-Encoding: gzip, deflate\r\n"
+		"Accept-Language: en-US,en;q=0.9,fr;q=0.8\r\n"
+		"If-None-Match: \"5f3e-1a2b3c4d\"\r\n"
+		"If-Modified-Since: Mon, 12 Oct 2026 08:12:44 GMT\r\n"
+		"\r\n",
+		// Scripted API call
+		"GET /api/v1/devices?id=42&fields=name,state HTTP/1.1\r\n"
+		"Host: localhost:8080\r\n"
+		"User-Agent: curl/8.5.0\r\n"
+		"Accept: */*\r\n"
+		"\r\n",
+		// WebSocket upgrade
+		"GET /ws HTTP/1.1\r\n"
+		"Host: 192.168.1.20:8080\r\n"
+		"Connection: Upgrade\r\n"
+		"Pragma: no-cache\r\n"
+		"Cache-Control: no-cache\r\n"
+		"User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4 Safari/605.1.15\r\n"
+		"Upgrade: websocket\r\n"
+		"Origin: http://192.168.1.20:8080\r\n"
+		"Sec-WebSocket-Version: 13\r\n"
+		"Accept-Encoding: gzip, deflate\r\n"
+		"Accept-Language: en-US,en;q=0.9\r\n"
+		"Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"
+		"Sec-WebSocket-Extensions: permessage-deflate; client_max_window_bits\r\n"
+		"\r\n",
+		// Form post
+		"POST /api/v1/settings HTTP/1.1\r\n"
+		"Host: 192.168.1.20:8080\r\n"
+		"Content-Type: application/json\r\n"
+		"Content-Length: 48\r\n"
+		"Origin: http://192.168.1.20:8080\r\n"
+		"Referer: http://192.168.1.20:8080/dashboard/settings.html\r\n"
+		"Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+		"\r\n"
+	};
+
+	const std::vector<std::string> headerNameCorpus = {
+		"Host", "Connection", "User-Agent", "Accept", "Accept-Encoding", "Accept-Language", "Cache-Control",
+		"Content-Type", "Content-Length", "Cookie", "Origin", "Referer", "Upgrade", "Sec-WebSocket-Key",
+		"Sec-WebSocket-Version", "Sec-WebSocket-Extensions", "If-None-Match", "If-Modified-Since", "Last-Event-ID", "Expect"
+	};
+
+	const std::vector<std::string> percentCorpus = {
+		"/dashboard/index.html",
+		"/files/My%20Documents/report%202026.pdf",
+		"q=caf%C3%A9+cr%C3%A8me&lang=fr&page=2",
+		"name=Jean-Fran%C3%A7ois+Dupont&email=jf%40example.com&note=%E2%9C%93+done",
+		"%2Fapi%2Fv1%2Fdevices%3Fid%3D42%26fields%3Dname%2Cstate"
+	};
+
+	const std::vector<size_t> payloadSizes = { 16, 125, 1024, 16 * 1024, 1024 * 1024 };
+
+	String sizeName(size_t size)
+	{
+		if (size >= 1024 * 1024) return String((int)(size / (1024 * 1024))) + "M";
+		if (size >= 1024) return String((int)(size / 1024)) + "K";
+		return String((int)size);
+	}
+
+	/// The kind of state streamed to a control surface on every frame: parameters with their metadata, and meters
+	var createStateVar()
+	{
+		DynamicObject::Ptr state = new DynamicObject();
+		state->setProperty("type", "state");
+		state->setProperty("frame", 123456);
+		state->setProperty("time", 2057.341666);
+
+		Array<var> parameters;
+		for (int i = 0; i < 64; i++)
+		{
+			DynamicObject::Ptr p = new DynamicObject();
+			p->setProperty("id", "/layers/layer" + String(i / 8) + "/param" + String(i % 8));
+			p->setProperty("value", std::sin(i * 0.37) * 0.5 + 0.5);
+			p->setProperty("min", 0);
+			p->setProperty("max", 1);
+			p->setProperty("enabled", i % 5 != 0);
+			parameters.add(var(p.get()));
+		}
+		state->setProperty("parameters", parameters);
+
+		Array<var> meters;
+		for (int i = 0; i < 128; i++) meters.add(std::abs(std::cos(i * 0.11)) * 0.8);
+		state->setProperty("meters", meters);
+
+		return var(state.get());
+	}
+
+	size_t totalSize(const std::vector<std::string>& corpus)
+	{
+		size_t size = 0;
+		for (auto& s : corpus) size += s.size();
+		return size;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options(argc, argv);
+	Benchmark::MicroBenchmarks benchmarks;
+
+	const std::array<unsigned char, 4> mask { { 0x3a, 0x91, 0x5c, 0xe7 } };
+
+	for (size_t size : payloadSizes)
+	{
+		// read_message_content: the payload follows the mask in the connection streambuf and is unmasked into the message
+		benchmarks.add("ws_server_unmask/" + sizeName(size), size, [size, mask](uint64 iterations)
+			{
+				asio::streambuf input;
+				auto in = input.prepare(size);
+				memset(in.data(), 0x55, size);
+				input.commit(size);
+
+				for (uint64 i = 0; i < iterations; i++)
+				{
+					asio::streambuf message;
+					auto destination = message.prepare(size);
+					SimpleWeb::WebSocketFrame::apply_mask(static_cast<const char*>(input.data().data()), static_cast<char*>(destination.data()), size, mask);
+					message.commit(size);
+					Benchmark::doNotOptimize(message);
+				}
+			});
+
+		// Connection::send: header and masked payload are written to one buffer. The mask is fixed here so that
+		// the random_device read, which is a system call on most platforms, doesn't hide the cost of the framing.
+		benchmarks.add("ws_client_frame/" + sizeName(size), size, [size, mask](uint64 iterations)
+			{
+				std::string payload(size, 'x');
+
+				for (uint64 i = 0; i < iterations; i++)
+				{
+					asio::streambuf frame;
+					unsigned char header[SimpleWeb::WebSocketFrame::max_header_size];
+					size_t headerSize = SimpleWeb::WebSocketFrame::write_header(header, 130, size, mask.data());
+					auto destination = frame.prepare(headerSize + size);
+					memcpy(destination.data(), header, headerSize);
+					SimpleWeb::WebSocketFrame::apply_mask(payload.data(), static_cast<char*>(destination.data()) + headerSize, size, mask);
+					frame.commit(headerSize + size);
+					Benchmark::doNotOptimize(frame);
+				}
+			});
+	}
+
+	benchmarks.add("ws_client_mask_key", 0, [](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				std::uniform_int_distribution<unsigned short> dist(0, 255);
+				std::random_device rd;
+				unsigned char key = static_cast<unsigned char>(dist(rd));
+				Benchmark::doNotOptimize(key);
+			}
+		});
+
+	benchmarks.add("http_request_parse", totalSize(requestCorpus), [](uint64 iterations)
+		{
+			MemoryStreamBuffer buffer;
+			std::istream stream(&buffer);
+			std::string method, path, queryString, version;
+			SimpleWeb::CaseInsensitiveMultimap header;
+
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				for (auto& request : requestCorpus)
+				{
+					buffer.reset(request);
+					stream.clear();
+					bool ok = SimpleWeb::RequestMessage::parse(stream, method, path, queryString, version, header);
+					Benchmark::doNotOptimize(ok);
+					Benchmark::doNotOptimize(header);
+				}
+			}
+		});
+
+	std::vector<std::string> headerCorpus;
+	for (auto& request : requestCorpus) headerCorpus.push_back(request.substr(request.find("\r\n") + 2));
+
+	benchmarks.add("http_header_parse", totalSize(headerCorpus), [headerCorpus](uint64 iterations)
+		{
+			MemoryStreamBuffer buffer;
+			std::istream stream(&buffer);
+
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				for (auto& header : headerCorpus)
+				{
+					buffer.reset(header);
+					stream.clear();
+					auto fields = SimpleWeb::HttpHeader::parse(stream);
+					Benchmark::doNotOptimize(fields);
+				}
+			}
+		});
+
+	benchmarks.add("case_insensitive_hash", totalSize(headerNameCorpus), [](uint64 iterations)
+		{
+			SimpleWeb::CaseInsensitiveHash hash;
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				for (auto& name : headerNameCorpus)
+				{
+					size_t h = hash(name);
+					Benchmark::doNotOptimize(h);
+				}
+			}
+		});
+
+	benchmarks.add("percent_decode", totalSize(percentCorpus), [](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				for (auto& value : percentCorpus)
+				{
+					auto decoded = SimpleWeb::Percent::decode(value);
+					Benchmark::doNotOptimize(decoded);
+				}
+			}
+		});
+
+	// Sec-WebSocket-Key followed by the GUID, as hashed for every WebSocket handshake
+	const std::string handshakeKey = "dGhlIHNhbXBsZSBub25jZQ==258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+	const std::string kilobyte(1024, 'k');
+
+	for (auto* input : { &handshakeKey, &kilobyte })
+	{
+		const std::string data = *input;
+		benchmarks.add("sha1/" + sizeName(data.size()), data.size(), [data](uint64 iterations)
+			{
+				unsigned char hash[20];
+				for (uint64 i = 0; i < iterations; i++)
+				{
+					WSCrypto::calcSha1(data.data(), (int)data.size(), hash);
+					Benchmark::doNotOptimize(hash[0]);
+				}
+			});
+	}
+
+	// A SHA-1 digest, as encoded in Sec-WebSocket-Accept, and a larger binary value
+	std::vector<std::vector<unsigned char>> base64Inputs = { std::vector<unsigned char>(20), std::vector<unsigned char>(1024) };
+	for (auto& input : base64Inputs)
+		for (size_t i = 0; i < input.size(); i++) input[i] = (unsigned char)(i * 131 + 7);
+
+	for (auto& input : base64Inputs)
+	{
+		benchmarks.add("base64_encode/" + sizeName(input.size()), input.size(), [input](uint64 iterations)
+			{
+				for (uint64 i = 0; i < iterations; i++)
+				{
+					auto encoded = WSCrypto::base64_encode(input.data(), (unsigned int)input.size());
+					Benchmark::doNotOptimize(encoded);
+				}
+			});
+	}
+
+	// The encoders write a new message each time, as sendMessagePack writes into a new OutMessage
+	const var state = createStateVar();
+	const std::string stateJSON = JSON::toString(state, true).toStdString();
+	const MemoryBlock statePacked = MessagePack::toMemoryBlock(state);
+
+	benchmarks.add("var_json_encode", stateJSON.size(), [state](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				std::string message = JSON::toString(state, true).toStdString();
+				Benchmark::doNotOptimize(message);
+			}
+		});
+
+	benchmarks.add("var_msgpack_encode", statePacked.getSize(), [state](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				asio::streambuf message;
+				std::ostream stream(&message);
+				MessagePack::write(stream, state);
+				Benchmark::doNotOptimize(message);
+			}
+		});
+
+	benchmarks.add("var_json_decode", stateJSON.size(), [stateJSON](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				var v = JSON::parse(String::fromUTF8(stateJSON.data(), (int)stateJSON.size()));
+				Benchmark::doNotOptimize(v);
+			}
+		});
+
+	benchmarks.add("var_msgpack_decode", statePacked.getSize(), [statePacked](uint64 iterations)
+		{
+			for (uint64 i = 0; i < iterations; i++)
+			{
+				var v = MessagePack::parse(statePacked);
+				Benchmark::doNotOptimize(v);
+			}
+		});
+
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("benchmark", "micro");
+	result->setProperty("results", benchmarks.run(options));
+	Benchmark::printResult(var(result.get()));
+	return 0;
+}
@@ -0,0 +1,121 @@
+/*
+  ==============================================================================
+
+	WebSocketFanOutBenchmark.cpp
+	Created: 19 Oct 2026
+
+	Starts a SimpleWebSocketServer on loopback, connects N WsClients sharing one
+	io_context, and broadcasts binary messages with SimpleWebSocketServer::send
+	at a fixed rate. Every payload starts with the time it was sent, so each
+	client measures the delivery latency from server send to client receive.
+
+	Options:
+		--clients N       number of clients (default 100)
+		--rate R          broadcasts per second (default 100)
+		--payload B       payload size in bytes, at least 8 (default 256)
+		--duration S      broadcast duration in seconds (default 10)
+		--threads T       client io threads (default 2)
+		--port P          server port (default 9980)
+
+  ==============================================================================
+*/
+
+#include "BenchmarkUtils.h"
+
+using namespace juce;
+
+int main(int argc, char* argv[])
+{
+	Benchmark::Options options(argc, argv);
+	const int numClients = jlimit(1, 100000, options.getInt("clients", 100));
+	const double rate = jmax(1.0, options.getDouble("rate", 100));
+	const int payloadSize = jmax(8, options.getInt("payload", 256));
+	const double duration = jmax(.1, options.getDouble("duration", 10));
+	const int numThreads = options.getInt("threads", 2);
+	const int port = options.getInt("port", 9980);
+
+	Benchmark::raiseFileLimit();
+
+	SimpleWebSocketServer server;
+	server.start(port, "", "127.0.0.1", true);
+	for (int i = 0; i < 500 && !server.isConnected; i++) Thread::sleep(10);
+	if (!server.isConnected)
+	{
+		std::cerr << "Could not start server on port " << port << std::endl;
+		return 1;
+	}
+
+	Benchmark::IOThreads io(numThreads);
+	Benchmark::LatencyHistogram latency;
+	std::atomic<int> numOpen { 0 };
+	std::atomic<juce::uint64> numReceived { 0 };
+	std::atomic<juce::uint64> bytesReceived { 0 };
+
+	std::vector<std::unique_ptr<WsClient>> clients;
+	const String url = "127.0.0.1:" + String(port) + "/";
+	for (int i = 0; i < numClients; i++)
+	{
+		std::unique_ptr<WsClient> client(new WsClient(url.toStdString()));
+		client->io_service = io.ioService;
+		client->on_open = [&numOpen](std::shared_ptr<WsClient::Connection>) { numOpen++; };
+		client->on_message = [&](std::shared_ptr<WsClient::Connection>, std::shared_ptr<WsClient::InMessage> message)
+			{
+				juce::int64 sentNs = 0;
+				message->read((char*)&sentNs, sizeof(sentNs));
+				latency.record(Benchmark::nowNs() - sentNs);
+				numReceived.fetch_add(1, std::memory_order_relaxed);
+				bytesReceived.fetch_add(message->size(), std::memory_order_relaxed);
+			};
+		client->start();
+		clients.push_back(std::move(client));
+
+		// Don't overflow the listen backlog
+		if (i % 256 == 255)
+		{
+			for (int w = 0; w < 200 && numOpen < i - 128; w++) Thread::sleep(5);
+		}
+	}
+
+	for (int w = 0; w < 1000 && numOpen < numClients; w++) Thread::sleep(10);
+
+	MemoryBlock payload((size_t)payloadSize, true);
+	const juce::int64 intervalNs = (juce::int64)(1e9 / rate);
+	const juce::int64 startNs = Benchmark::nowNs();
+	const juce::int64 endNs = startNs + (juce::int64)(duration * 1e9);
+	juce::uint64 numBroadcasts = 0;
+
+	for (juce::int64 next = startNs; next < endNs; next += intervalNs)
+	{
+		juce::int64 wait = next - Benchmark::nowNs();
+		if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds(wait));
+
+		juce::int64 now = Benchmark::nowNs();
+		memcpy(payload.getData(), &now, sizeof(now));
+		server.send((const char*)payload.getData(), payloadSize);
+		numBroadcasts++;
+	}
+
+	const juce::uint64 expected = numBroadcasts * (juce::uint64)numOpen.load();
+	for (int w = 0; w < 200 && numReceived < expected; w++) Thread::sleep(10);
+	const double elapsed = (Benchmark::nowNs() - startNs) / 1e9;
+
+	DynamicObject::Ptr result = new DynamicObject();
+	result->setProperty("benchmark", "websocket_fan_out");
+	result->setProperty("clients", numClients);
+	result->setProperty("connected", numOpen.load());
+	result->setProperty("rate", rate);
+	result->setProperty("payload_bytes", payloadSize);
+	result->setProperty("duration_s", elapsed);
+	result->setProperty("broadcasts", (juce::int64)numBroadcasts);
+	result->setProperty("expected", (juce::int64)expected);
+	result->setProperty("received", (juce::int64)numReceived.load());
+	result->setProperty("messages_per_s", numReceived.load() / elapsed);
+	result->setProperty("mb_per_s", bytesReceived.load() / elapsed / (1024.0 * 1024.0));
+	result->setProperty("latency", latency.toVar());
+	Benchmark::printResult(var(result.get()));
+
+	for (auto& c : clients) c->stop();
+	io.stop();
+	server.stop();
+	return 0;
+}
@@ -54,6 +54,19 @@ namespace SimpleWeb {
   inline asio::executor_work_guard<io_context::executor_type> make_work_guard(io_context &context) {
     return asio::make_work_guard(context);
   }
+  template <typename socket_type, typename handler_type>
+  void async_wait_readable(socket_type &socket, handler_type &&handler) {
+    socket.async_wait(asio::socket_base::wait_read, std::forward<handler_type>(handler));
+  }
+  template <typename socket_type, typename handler_type>
+  void async_wait_writable(socket_type &socket, handler_type &&handler) {
+    socket.async_wait(asio::socket_base::wait_write, std::forward<handler_type>(handler));
+  }
+  /// The handler, and the intermediate steps of a composed operation it completes, run on context.
+  template <typename handler_type>
+  auto bind_executor(io_context &context, handler_type &&handler) -> decltype(asio::bind_executor(context.get_executor(), std::forward<handler_type>(handler))) {
+    return asio::bind_executor(context.get_executor(), std::forward<handler_type>(handler));
+  }
 #else
   using io_context = asio::io_service;
   using resolver_results = asio::ip::tcp::resolver::iterator;
@@ -80,7 +93,44 @@ namespace SimpleWeb {
   inline io_context::work make_work_guard(io_context &context) {
     return io_context::work(context);
   }
+  template <typename socket_type, typename handler_type>
+  void async_wait_readable(socket_type &socket, handler_type handler) {
+    socket.async_read_some(asio::null_buffers(), [handler](const error_code &ec, std::size_t /*bytes_transferred*/) mutable {
+      handler(ec);
+    });
+  }
+  template <typename socket_type, typename handler_type>
+  void async_wait_writable(socket_type &socket, handler_type handler) {
+    socket.async_write_some(asio::null_buffers(), [handler](const error_code &ec, std::size_t /*bytes_transferred*/) mutable {
+      handler(ec);
+    });
+  }
+  template <typename handler_type>
+  auto bind_executor(io_context &context, handler_type &&handler) -> decltype(context.wrap(std::forward<handler_type>(handler))) {
+    return context.wrap(std::forward<handler_type>(handler));
+  }
 #endif
+
+  /// Called on the socket of a server or client connection right before it is destroyed. Specialized for TLS streams in tls_session.hpp.
+  template <typename socket_type>
+  struct ConnectionTeardown {
+    static void before_destroy(socket_type &) noexcept {}
+  };
+
+  /// Writes to the socket of a server connection. Specialized for TLS streams in tls_session.hpp, which are written past
+  /// OpenSSL once the kernel encrypts them.
+  template <typename socket_type>
+  struct SocketWriter {
+    template <typename buffers_type, typename handler_type>
+    static void async_write(socket_type &socket, buffers_type &&buffers, handler_type &&handler) {
+      asio::async_write(socket, std::forward<buffers_type>(buffers), std::forward<handler_type>(handler));
+    }
+
+    /// The socket that sendfile() can write to, or nullptr if what is written must go through user space.
+    static typename socket_type::lowest_layer_type *sendfile_socket(socket_type &socket) noexcept {
+      return &socket.lowest_layer();
+    }
+  };
 } // namespace SimpleWeb
 
 #endif /* SIMPLE_WEB_ASIO_COMPATIBILITY_HPP */
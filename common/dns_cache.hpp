@@ -0,0 +1,183 @@
+#ifndef SIMPLE_WEB_DNS_CACHE_HPP
+#define SIMPLE_WEB_DNS_CACHE_HPP
+
+#include "asio_compatibility.hpp"
+#include "mutex.hpp"
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace SimpleWeb {
+  /// Resolved addresses shared by all the clients of a process.
+  /// getaddrinfo does not report the TTL of the records, so entries are kept for the time given by each lookup.
+  /// Concurrent lookups of the same host and port share one resolution.
+  class DnsCache {
+  public:
+    using endpoints_type = std::vector<asio::ip::tcp::endpoint>;
+    using handler_type = std::function<void(const error_code &, const endpoints_type &)>;
+
+    static DnsCache &shared() {
+      static DnsCache cache;
+      return cache;
+    }
+
+    /// Calls handler on io_service with the addresses of host and port, in the order returned by the system resolver.
+    /// They are reused for ttl_seconds, or resolved every time if ttl_seconds is 0. A lookup that has not completed after
+    /// timeout_seconds, if not 0, fails with timed_out for all the calls that share it. Calls made once a lookup is older
+    /// than that, or than max_share_seconds without a timeout, start over instead of waiting for it, since its io_service
+    /// may have been stopped. A lookup whose io_service is destroyed before it completes fails with operation_canceled.
+    void async_resolve(const std::shared_ptr<io_context> &io_service, const std::pair<std::string, std::string> &host_port, long ttl_seconds, long timeout_seconds, handler_type handler) {
+      auto key = host_port.first + ':' + host_port.second;
+      auto now = std::chrono::steady_clock::now();
+      std::shared_ptr<Lookup> lookup;
+      std::vector<waiter_type> abandoned;
+      {
+        LockGuard lock(mutex);
+        auto it = entries.find(key);
+        if(it != entries.end()) {
+          auto &entry = it->second;
+          if(entry.lookup) {
+            if(now < entry.lookup->deadline) {
+              entry.lookup->waiters.emplace_back(io_service, std::move(handler));
+              return;
+            }
+            // The io_service of the lookup may have been stopped, in which case it would never complete
+            abandoned = finish(*entry.lookup, make_error_code::make_error_code(errc::timed_out), endpoints_type());
+            it = entries.find(key);
+          }
+          else if(ttl_seconds > 0 && now < entry.expires) {
+            auto endpoints = entry.endpoints;
+            lock.unlock();
+            post(*io_service, [handler, endpoints] {
+              handler(error_code(), endpoints);
+            });
+            return;
+          }
+        }
+
+        lookup = std::make_shared<Lookup>(*this, key, ttl_seconds);
+        lookup->deadline = now + std::chrono::seconds(timeout_seconds > 0 ? timeout_seconds : max_share_seconds);
+        lookup->waiters.emplace_back(io_service, std::move(handler));
+        if(timeout_seconds > 0) {
+          lookup->timer = std::unique_ptr<asio::steady_timer>(new asio::steady_timer(*io_service, std::chrono::seconds(timeout_seconds)));
+          lookup->timer->async_wait([this, lookup](const error_code &ec) {
+            if(!ec)
+              this->complete(*lookup, make_error_code::make_error_code(errc::timed_out), endpoints_type());
+          });
+        }
+        entries[key].lookup = lookup.get();
+      }
+      call(abandoned, make_error_code::make_error_code(errc::timed_out), endpoints_type());
+
+      auto resolver = std::make_shared<asio::ip::tcp::resolver>(*io_service);
+      SimpleWeb::async_resolve(*resolver, host_port, [this, lookup, resolver](const error_code &ec, resolver_results results) {
+        endpoints_type endpoints;
+        if(!ec) {
+          for(auto it = results; it != resolver_results(); ++it)
+            endpoints.emplace_back(it->endpoint());
+        }
+        this->complete(*lookup, ec, endpoints);
+      });
+    }
+
+    /// Forgets the addresses of host and port, for instance once none of them could be connected to
+    void invalidate(const std::pair<std::string, std::string> &host_port) {
+      LockGuard lock(mutex);
+      auto it = entries.find(host_port.first + ':' + host_port.second);
+      if(it != entries.end() && !it->second.lookup)
+        entries.erase(it);
+    }
+
+    void clear() {
+      LockGuard lock(mutex);
+      for(auto it = entries.begin(); it != entries.end();) {
+        if(it->second.lookup)
+          ++it;
+        else
+          it = entries.erase(it);
+      }
+    }
+
+    static constexpr long max_share_seconds = 30;
+
+  private:
+    // Waiters are called on their own io_service, which need not be the one that runs the lookup, unless it is gone
+    using waiter_type = std::pair<std::weak_ptr<io_context>, handler_type>;
+
+    /// A resolution shared by the calls made while it runs. Owned by the handlers of its resolver and timer, so that it
+    /// is destroyed, and completes if it has not, when they have run or when their io_service is destroyed.
+    struct Lookup {
+      Lookup(DnsCache &cache, std::string key, long ttl_seconds) noexcept : cache(cache), key(std::move(key)), ttl_seconds(ttl_seconds) {}
+      ~Lookup() {
+        cache.complete(*this, make_error_code::make_error_code(errc::operation_canceled), endpoints_type());
+      }
+
+      DnsCache &cache;
+      const std::string key;
+      const long ttl_seconds;
+      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+      std::unique_ptr<asio::steady_timer> timer;
+      bool done GUARDED_BY(cache.mutex) = false;
+      std::vector<waiter_type> waiters GUARDED_BY(cache.mutex);
+    };
+
+    struct Entry {
+      endpoints_type endpoints;
+      std::chrono::steady_clock::time_point expires;
+      Lookup *lookup = nullptr; // The lookup in progress, if any. It detaches itself from the entry before it is destroyed
+    };
+
+    Mutex mutex;
+    std::unordered_map<std::string, Entry> entries GUARDED_BY(mutex);
+
+    /// Marks lookup as done, stores its result in its entry if it is still the lookup of it, and returns its waiters.
+    /// Only the first call for a lookup has an effect.
+    std::vector<waiter_type> finish(Lookup &lookup, const error_code &ec, const endpoints_type &endpoints) REQUIRES(mutex) {
+      if(lookup.done)
+        return {};
+      lookup.done = true;
+      if(lookup.timer) {
+        error_code _ec;
+        lookup.timer->cancel(_ec);
+      }
+
+      auto it = entries.find(lookup.key);
+      if(it != entries.end() && it->second.lookup == &lookup) {
+        if(ec || lookup.ttl_seconds <= 0)
+          entries.erase(it);
+        else {
+          it->second.lookup = nullptr;
+          it->second.endpoints = endpoints;
+          it->second.expires = std::chrono::steady_clock::now() + std::chrono::seconds(lookup.ttl_seconds);
+        }
+      }
+      return std::move(lookup.waiters);
+    }
+
+    void complete(Lookup &lookup, const error_code &ec, const endpoints_type &endpoints) {
+      std::vector<waiter_type> waiters;
+      {
+        LockGuard lock(mutex);
+        waiters = finish(lookup, ec, endpoints);
+      }
+      call(waiters, ec, endpoints);
+    }
+
+    static void call(std::vector<waiter_type> &waiters, const error_code &ec, const endpoints_type &endpoints) {
+      for(auto &waiter : waiters) {
+        auto io_service = waiter.first.lock();
+        if(!io_service)
+          continue;
+        auto handler = std::move(waiter.second);
+        post(*io_service, [handler, ec, endpoints] {
+          handler(ec, endpoints);
+        });
+      }
+    }
+  };
+} // namespace SimpleWeb
+
+#endif /* SIMPLE_WEB_DNS_CACHE_HPP */
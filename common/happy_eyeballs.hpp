@@ -0,0 +1,184 @@
+#ifndef SIMPLE_WEB_HAPPY_EYEBALLS_HPP
+#define SIMPLE_WEB_HAPPY_EYEBALLS_HPP
+
+#include "asio_compatibility.hpp"
+#include "mutex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace SimpleWeb {
+  /// Connects a socket to the first of several addresses to answer, racing the attempts as in RFC 8305 Happy Eyeballs:
+  /// the addresses are interleaved by family, and the next attempt starts when the previous one fails or has not
+  /// succeeded within attempt_delay, without cancelling it. A dead IPv6 route thus costs attempt_delay instead of a timeout.
+  class HappyEyeballs : public std::enable_shared_from_this<HappyEyeballs> {
+  public:
+    using socket_type = asio::ip::tcp::socket::lowest_layer_type;
+    using handler_type = std::function<void(const error_code &, const asio::ip::tcp::endpoint &)>;
+
+    /// Orders endpoints as in RFC 8305 section 4: the family of the first endpoint, then the other one, in turn.
+    /// The order within each family, which is that of the system resolver, is kept.
+    static std::vector<asio::ip::tcp::endpoint> interleave(const std::vector<asio::ip::tcp::endpoint> &endpoints) {
+      std::vector<asio::ip::tcp::endpoint> first, second, interleaved;
+      for(auto &endpoint : endpoints)
+        (endpoints.front().address().is_v6() == endpoint.address().is_v6() ? first : second).emplace_back(endpoint);
+      for(std::size_t c = 0; c < (std::max)(first.size(), second.size()); c++) {
+        if(c < first.size())
+          interleaved.emplace_back(first[c]);
+        if(c < second.size())
+          interleaved.emplace_back(second[c]);
+      }
+      return interleaved;
+    }
+
+    /// Connects socket to one of endpoints, tried in the given order, and calls handler with the endpoint that was connected.
+    /// attempt_delay_ms 0 tries one endpoint after the other. The whole race is abandoned after timeout_seconds, if not 0.
+    /// socket and handler must stay valid until handler is called, which happens exactly once.
+    /// Returns the race, to cancel() it, or nullptr if endpoints is empty.
+    static std::shared_ptr<HappyEyeballs> async_connect(io_context &io_service, socket_type &socket, std::vector<asio::ip::tcp::endpoint> endpoints,
+                              long attempt_delay_ms, long timeout_seconds, handler_type handler) {
+      if(endpoints.empty()) {
+        post(io_service, [handler] {
+          handler(make_error_code::make_error_code(errc::address_not_available), asio::ip::tcp::endpoint());
+        });
+        return nullptr;
+      }
+
+      std::shared_ptr<HappyEyeballs> race(new HappyEyeballs(io_service, socket, std::move(endpoints), attempt_delay_ms, std::move(handler)));
+      LockGuard lock(race->mutex);
+      if(timeout_seconds > 0) {
+        race->timeout_timer = std::unique_ptr<asio::steady_timer>(new asio::steady_timer(io_service, std::chrono::seconds(timeout_seconds)));
+        race->timeout_timer->async_wait([race](const error_code &ec) {
+          if(!ec)
+            race->finish(make_error_code::make_error_code(errc::timed_out), -1);
+        });
+      }
+      race->start_next();
+      return race;
+    }
+
+    /// Closes the attempts, and calls the handler with operation_aborted on the io_service, unless the race has already ended.
+    /// A connected attempt is not moved into the socket once this has been called.
+    void cancel() noexcept {
+      {
+        LockGuard lock(mutex);
+        if(!handler)
+          return;
+        canceled = true;
+        error_code ec;
+        if(delay_timer)
+          delay_timer->cancel(ec);
+        for(auto &attempt : attempts)
+          attempt->close(ec);
+      }
+      auto self = this->shared_from_this();
+      post(io_service, [self] {
+        self->finish(error::operation_aborted, -1);
+      });
+    }
+
+  private:
+    HappyEyeballs(io_context &io_service, socket_type &socket, std::vector<asio::ip::tcp::endpoint> &&endpoints, long attempt_delay_ms, handler_type &&handler) noexcept
+        : io_service(io_service), socket(socket), endpoints(std::move(endpoints)), attempt_delay_ms(attempt_delay_ms), handler(std::move(handler)) {}
+
+    io_context &io_service;
+    socket_type &socket;
+    const std::vector<asio::ip::tcp::endpoint> endpoints;
+    const long attempt_delay_ms;
+
+    // Attempt handlers may run concurrently when the io_service is run by several threads
+    Mutex mutex;
+    handler_type handler GUARDED_BY(mutex);
+    std::vector<std::unique_ptr<asio::ip::tcp::socket>> attempts GUARDED_BY(mutex);
+    std::size_t num_failed GUARDED_BY(mutex) = 0;
+    bool canceled GUARDED_BY(mutex) = false;
+    error_code last_error GUARDED_BY(mutex);
+    std::unique_ptr<asio::steady_timer> delay_timer GUARDED_BY(mutex);
+    std::unique_ptr<asio::steady_timer> timeout_timer GUARDED_BY(mutex);
+
+    void start_next() REQUIRES(mutex) {
+      if(attempts.size() >= endpoints.size())
+        return;
+
+      auto index = attempts.size();
+      attempts.emplace_back(new asio::ip::tcp::socket(io_service));
+      auto self = this->shared_from_this();
+      attempts.back()->async_connect(endpoints[index], [self, index](const error_code &ec) {
+        if(!ec)
+          self->finish(ec, static_cast<long>(index));
+        else
+          self->attempt_failed(ec);
+      });
+
+      if(attempt_delay_ms > 0 && attempts.size() < endpoints.size()) {
+        delay_timer = std::unique_ptr<asio::steady_timer>(new asio::steady_timer(io_service, std::chrono::milliseconds(attempt_delay_ms)));
+        delay_timer->async_wait([self](const error_code &ec) {
+          if(ec)
+            return;
+          LockGuard lock(self->mutex);
+          if(self->handler && !self->canceled)
+            self->start_next();
+        });
+      }
+    }
+
+    void attempt_failed(const error_code &ec) {
+      LockGuard lock(mutex);
+      if(!handler || canceled)
+        return;
+
+      last_error = ec;
+      ++num_failed;
+      if(attempts.size() < endpoints.size()) {
+        // No need to wait for the delay once an attempt has failed
+        if(delay_timer) {
+          error_code cancel_ec;
+          delay_timer->cancel(cancel_ec);
+        }
+        start_next();
+      }
+      else if(num_failed == attempts.size()) {
+        auto error = last_error;
+        lock.unlock();
+        finish(error, -1);
+      }
+    }
+
+    /// Ends the race, moving the winning socket into socket if index is not -1, and closing the others
+    void finish(error_code ec, long index) {
+      handler_type handler;
+      asio::ip::tcp::endpoint endpoint;
+      {
+        LockGuard lock(mutex);
+        if(!this->handler)
+          return;
+        handler = std::move(this->handler);
+        this->handler = nullptr;
+        if(canceled) {
+          ec = error::operation_aborted;
+          index = -1;
+        }
+
+        error_code cancel_ec;
+        if(delay_timer)
+          delay_timer->cancel(cancel_ec);
+        if(timeout_timer)
+          timeout_timer->cancel(cancel_ec);
+
+        for(std::size_t c = 0; c < attempts.size(); c++) {
+          if(static_cast<long>(c) == index) {
+            socket = std::move(*attempts[c]);
+            endpoint = endpoints[c];
+          }
+          else
+            attempts[c]->close(cancel_ec);
+        }
+      }
+      handler(ec, endpoint);
+    }
+  };
+} // namespace SimpleWeb
+
+#endif /* SIMPLE_WEB_HAPPY_EYEBALLS_HPP */
@@ -0,0 +1,104 @@
+#ifndef SIMPLE_WEB_LOCAL_SOCKET_HPP
+#define SIMPLE_WEB_LOCAL_SOCKET_HPP
+
+#include "asio_compatibility.hpp"
+#include <string>
+
+#if defined(ASIO_HAS_LOCAL_SOCKETS) || defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+#include <cerrno>
+#include <sys/stat.h>
+#include <unistd.h>
+#define SIMPLE_WEB_LOCAL_SOCKETS 1
+#endif
+
+namespace SimpleWeb {
+  /// Unix domain sockets, for clients on the same host to skip the TCP stack. A connected local socket hands its descriptor
+  /// over to the asio::ip::tcp::socket of a connection, which only reads, writes and waits on it, so that the HTTP and
+  /// WebSocket code runs unchanged over both. TCP socket options fail on such connections, and they have no IP endpoints.
+  class LocalSocket {
+  public:
+    /// Splits a URL of the form unix:<socket path>[:<request path>], e.g. unix:/tmp/app.sock:/ws, into the path of the socket
+    /// and the request path, which defaults to /. Returns false if url does not start with unix:.
+    static bool parse_url(const std::string &url, std::string &socket_path, std::string &path) {
+      if(url.compare(0, 5, "unix:") != 0)
+        return false;
+      auto path_start = url.find(":/", 5);
+      socket_path = url.substr(5, path_start != std::string::npos ? path_start - 5 : std::string::npos);
+      path = path_start != std::string::npos ? url.substr(path_start + 1) : "/";
+      return true;
+    }
+
+    /// The peer of socket, or an unspecified endpoint with port 0 if the socket was adopted from a local socket.
+    /// Throws like remote_endpoint() if the address of the peer does not fit in an IP endpoint.
+    template <typename socket_type>
+    static asio::ip::tcp::endpoint remote_endpoint(const socket_type &socket) {
+      auto endpoint = socket.remote_endpoint();
+      auto family = endpoint.data()->sa_family;
+      return family == AF_INET || family == AF_INET6 ? endpoint : asio::ip::tcp::endpoint();
+    }
+
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+    using protocol_type = asio::local::stream_protocol;
+
+    /// Binds acceptor to path and listens. A socket file left at path by a process that is gone is removed first, while
+    /// one that is still listened on makes this throw address_in_use. The acceptor is closed again if this throws.
+    static void listen(io_context &io_service, protocol_type::acceptor &acceptor, const std::string &path) {
+      protocol_type::endpoint endpoint(path);
+
+      struct stat info;
+      if(::stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+        protocol_type::socket probe(io_service);
+        error_code ec;
+        probe.connect(endpoint, ec);
+        if(!ec)
+          throw system_error(error::address_in_use);
+        if(ec == error::connection_refused)
+          ::unlink(path.c_str());
+      }
+
+      try {
+        acceptor.open(endpoint.protocol());
+        acceptor.bind(endpoint);
+        acceptor.listen();
+      }
+      catch(...) {
+        error_code ec;
+        acceptor.close(ec);
+        throw;
+      }
+    }
+
+    /// Closes an acceptor that listen() succeeded on, and removes its socket file.
+    static void close(protocol_type::acceptor &acceptor) noexcept {
+      if(!acceptor.is_open())
+        return;
+      error_code ec;
+      auto path = acceptor.local_endpoint(ec).path();
+      acceptor.close(ec);
+      if(!path.empty())
+        ::unlink(path.c_str());
+    }
+
+    /// Moves the descriptor of the connected socket local into socket, which must be closed. local is closed afterwards.
+    static void adopt(protocol_type::socket &local, asio::ip::tcp::socket::lowest_layer_type &socket, error_code &ec) {
+#if(USE_STANDALONE_ASIO && ASIO_VERSION >= 101300) || BOOST_ASIO_VERSION >= 101300
+      auto handle = local.release(ec);
+      if(ec)
+        return;
+#else
+      auto handle = ::dup(local.native_handle());
+      if(handle < 0) {
+        ec = error_code(errno, asio::error::get_system_category());
+        return;
+      }
+      local.close(ec);
+#endif
+      socket.assign(asio::ip::tcp::v4(), handle, ec);
+      if(ec)
+        ::close(handle);
+    }
+#endif
+  };
+} // namespace SimpleWeb
+
+#endif /* SIMPLE_WEB_LOCAL_SOCKET_HPP */
@@ -0,0 +1,559 @@
+#ifndef SIMPLE_WEB_TLS_SESSION_HPP
+#define SIMPLE_WEB_TLS_SESSION_HPP
+
+#include "asio_compatibility.hpp"
+#include "mutex.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../openssl/evp.h"
+#include "../openssl/hmac.h"
+#include "../openssl/kdf.h"
+#include "../openssl/rand.h"
+#include "../openssl/ssl.h"
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include "../openssl/core_names.h"
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/tls.h>)
+#include <linux/tls.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#define SIMPLE_WEB_KERNEL_TLS 1
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#endif
+#endif
+
+#ifdef USE_STANDALONE_ASIO
+#include "../asio/ssl.hpp"
+#else
+#include <boost/asio/ssl.hpp>
+#endif
+
+namespace SimpleWeb {
+  template <>
+  struct ConnectionTeardown<asio::ssl::stream<asio::ip::tcp::socket>> {
+    /// OpenSSL removes the session of a connection freed without a TLS shutdown from the cache, and marks it as not
+    /// resumable, while the servers and clients close their sockets without one. HTTP and WebSocket messages carry their
+    /// own length, so a truncated connection can't pass for a complete one, and the session is kept for resumption.
+    static void before_destroy(asio::ssl::stream<asio::ip::tcp::socket> &socket) noexcept {
+      SSL_set_shutdown(socket.native_handle(), SSL_SENT_SHUTDOWN | SSL_RECEIVED_SHUTDOWN);
+    }
+  };
+
+  /// Kernel TLS for server connections on Linux. Once the handshake is done, the keys that encrypt what the server sends
+  /// are installed into the socket: writes then skip the copy through OpenSSL, and files can go out with sendfile().
+  /// What the client sends is still decrypted by OpenSSL.
+  class KernelTls {
+  public:
+    /// The keys that encrypt the records sent by the server of a TLS 1.2 AES-GCM connection.
+    struct TransmitKeys {
+      std::size_t key_size = 0; // 16 or 32
+      unsigned char key[32];
+      unsigned char salt[4];
+    };
+
+    /// Derives the keys from the master secret of the session, as in RFC 5246 section 6.3.
+    /// Returns false for another protocol version or cipher.
+    static bool derive_transmit_keys(SSL *ssl, TransmitKeys &keys) noexcept {
+      auto cipher = SSL_get_current_cipher(ssl);
+      if(SSL_version(ssl) != TLS1_2_VERSION || !cipher)
+        return false;
+      auto nid = SSL_CIPHER_get_cipher_nid(cipher);
+      if(nid == NID_aes_128_gcm)
+        keys.key_size = 16;
+      else if(nid == NID_aes_256_gcm)
+        keys.key_size = 32;
+      else
+        return false;
+
+      unsigned char master_key[SSL_MAX_MASTER_KEY_LENGTH];
+      auto master_key_size = SSL_SESSION_get_master_key(SSL_get_session(ssl), master_key, sizeof(master_key));
+      unsigned char randoms[2 * SSL3_RANDOM_SIZE];
+      SSL_get_server_random(ssl, randoms, SSL3_RANDOM_SIZE);
+      SSL_get_client_random(ssl, randoms + SSL3_RANDOM_SIZE, SSL3_RANDOM_SIZE);
+
+      // The AEAD key block holds the client and server write keys, then the client and server implicit nonces
+      unsigned char key_block[2 * 32 + 2 * 4];
+      std::size_t key_block_size = 2 * keys.key_size + 2 * sizeof(keys.salt);
+      static const char label[] = "key expansion";
+      auto prf = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+      bool derived = prf && EVP_PKEY_derive_init(prf) == 1 &&
+                     EVP_PKEY_CTX_set_tls1_prf_md(prf, SSL_CIPHER_get_handshake_digest(cipher)) == 1 &&
+                     EVP_PKEY_CTX_set1_tls1_prf_secret(prf, master_key, static_cast<int>(master_key_size)) == 1 &&
+                     EVP_PKEY_CTX_add1_tls1_prf_seed(prf, reinterpret_cast<const unsigned char *>(label), static_cast<int>(sizeof(label) - 1)) == 1 &&
+                     EVP_PKEY_CTX_add1_tls1_prf_seed(prf, randoms, static_cast<int>(sizeof(randoms))) == 1 &&
+                     EVP_PKEY_derive(prf, key_block, &key_block_size) == 1;
+      EVP_PKEY_CTX_free(prf);
+
+      if(derived) {
+        std::memcpy(keys.key, key_block + keys.key_size, keys.key_size);
+        std::memcpy(keys.salt, key_block + 2 * keys.key_size + sizeof(keys.salt), sizeof(keys.salt));
+      }
+      OPENSSL_cleanse(master_key, sizeof(master_key));
+      OPENSSL_cleanse(key_block, sizeof(key_block));
+      return derived;
+    }
+
+    /// Call right after the handshake of a server connection, before anything is written to it. Returns false, leaving
+    /// the connection to OpenSSL, where the kernel has no TLS support or the connection another cipher than AES-GCM.
+    static bool enable(asio::ssl::stream<asio::ip::tcp::socket> &socket) noexcept {
+#ifdef SIMPLE_WEB_KERNEL_TLS
+      auto ssl = socket.native_handle();
+      TransmitKeys keys;
+      if(!derive_transmit_keys(ssl, keys))
+        return false;
+
+      // The server has sent a single encrypted record, its Finished message, so the next sequence number is 1.
+      // The explicit part of the nonce follows the sequence number, as OpenSSL does.
+      unsigned char sequence[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+      union {
+        tls12_crypto_info_aes_gcm_128 aes_128;
+        tls12_crypto_info_aes_gcm_256 aes_256;
+      } info;
+      std::memset(&info, 0, sizeof(info));
+      socklen_t info_size;
+      if(keys.key_size == 16) {
+        info.aes_128.info.version = TLS_1_2_VERSION;
+        info.aes_128.info.cipher_type = TLS_CIPHER_AES_GCM_128;
+        std::memcpy(info.aes_128.key, keys.key, 16);
+        std::memcpy(info.aes_128.salt, keys.salt, sizeof(keys.salt));
+        std::memcpy(info.aes_128.iv, sequence, sizeof(sequence));
+        std::memcpy(info.aes_128.rec_seq, sequence, sizeof(sequence));
+        info_size = sizeof(info.aes_128);
+      }
+      else {
+        info.aes_256.info.version = TLS_1_2_VERSION;
+        info.aes_256.info.cipher_type = TLS_CIPHER_AES_GCM_256;
+        std::memcpy(info.aes_256.key, keys.key, 32);
+        std::memcpy(info.aes_256.salt, keys.salt, sizeof(keys.salt));
+        std::memcpy(info.aes_256.iv, sequence, sizeof(sequence));
+        std::memcpy(info.aes_256.rec_seq, sequence, sizeof(sequence));
+        info_size = sizeof(info.aes_256);
+      }
+
+      auto fd = socket.next_layer().native_handle();
+      bool enabled = setsockopt(fd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+                     setsockopt(fd, SOL_TLS, TLS_TX, &info, info_size) == 0;
+      OPENSSL_cleanse(&info, sizeof(info));
+      OPENSSL_cleanse(&keys, sizeof(keys));
+      if(!enabled)
+        return false;
+
+      // A renegotiation would have OpenSSL write records of its own, out of sequence with the kernel
+      SSL_set_options(ssl, SSL_OP_NO_RENEGOTIATION);
+      SSL_set_ex_data(ssl, ex_data_index(), &socket);
+      return true;
+#else
+      (void)socket;
+      return false;
+#endif
+    }
+
+    static bool is_enabled(asio::ssl::stream<asio::ip::tcp::socket> &socket) noexcept {
+      return SSL_get_ex_data(socket.native_handle(), ex_data_index()) != nullptr;
+    }
+
+  private:
+    static int ex_data_index() {
+      static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+      return index;
+    }
+  };
+
+  /// Dynamic TLS record sizing for a server context. A client can't decrypt any of a record before all of it has arrived,
+  /// so connections start with small records that fit in a TCP segment, and switch to full 16 kB records, which cost
+  /// less overhead, once ramp_bytes have been sent. A connection that has not written for idle_reset starts over.
+  /// The size is chosen for each write, which then goes out in records of that size. Kernel TLS writes are not affected.
+  class TlsRecordSizing {
+    struct State {
+      std::size_t bytes_sent = 0;
+      std::size_t record_size = SSL3_RT_MAX_PLAIN_LENGTH;
+      std::chrono::steady_clock::time_point last_write;
+    };
+
+    std::size_t initial_record_size = 0;
+    std::size_t ramp_bytes = 0;
+    std::chrono::milliseconds idle_reset;
+
+  public:
+    /// An initial_record_size of 0 leaves OpenSSL writing full records. Sizes are kept within 512 bytes and 16 kB.
+    void enable(SSL_CTX *context, std::size_t initial_record_size, std::size_t ramp_bytes, long idle_reset_ms) {
+      this->initial_record_size = initial_record_size > 0 ? std::min<std::size_t>(std::max<std::size_t>(initial_record_size, 512), SSL3_RT_MAX_PLAIN_LENGTH) : 0;
+      this->ramp_bytes = ramp_bytes;
+      idle_reset = std::chrono::milliseconds(idle_reset_ms);
+      SSL_CTX_set_ex_data(context, context_index(), this->initial_record_size > 0 ? this : nullptr);
+    }
+
+    /// Sets the record size for the next write of size bytes on ssl.
+    static void before_write(SSL *ssl, std::size_t size) {
+      auto sizing = static_cast<TlsRecordSizing *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+      if(!sizing)
+        return;
+
+      auto state = static_cast<State *>(SSL_get_ex_data(ssl, connection_index()));
+      if(!state) {
+        state = new State();
+        SSL_set_ex_data(ssl, connection_index(), state);
+      }
+
+      auto now = std::chrono::steady_clock::now();
+      if(now - state->last_write >= sizing->idle_reset)
+        state->bytes_sent = 0;
+      state->last_write = now;
+
+      auto record_size = state->bytes_sent < sizing->ramp_bytes ? sizing->initial_record_size : static_cast<std::size_t>(SSL3_RT_MAX_PLAIN_LENGTH);
+      if(record_size != state->record_size) {
+        // Lowering the maximum also lowers the split fragment size, which must be raised again with it
+        SSL_set_max_send_fragment(ssl, static_cast<long>(record_size));
+        SSL_set_split_send_fragment(ssl, static_cast<long>(record_size));
+        state->record_size = record_size;
+      }
+      state->bytes_sent += size;
+    }
+
+  private:
+    static int context_index() {
+      static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+      return index;
+    }
+
+    static int connection_index() {
+      static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, [](void *, void *state, CRYPTO_EX_DATA *, int, long, void *) {
+        delete static_cast<State *>(state);
+      });
+      return index;
+    }
+  };
+
+  template <>
+  struct SocketWriter<asio::ssl::stream<asio::ip::tcp::socket>> {
+    template <typename buffers_type, typename handler_type>
+    static void async_write(asio::ssl::stream<asio::ip::tcp::socket> &socket, buffers_type &&buffers, handler_type &&handler) {
+      if(KernelTls::is_enabled(socket))
+        asio::async_write(socket.next_layer(), std::forward<buffers_type>(buffers), std::forward<handler_type>(handler));
+      else {
+        TlsRecordSizing::before_write(socket.native_handle(), size(buffers));
+        asio::async_write(socket, std::forward<buffers_type>(buffers), std::forward<handler_type>(handler));
+      }
+    }
+
+    static asio::ssl::stream<asio::ip::tcp::socket>::lowest_layer_type *sendfile_socket(asio::ssl::stream<asio::ip::tcp::socket> &socket) noexcept {
+      return KernelTls::is_enabled(socket) ? &socket.lowest_layer() : nullptr;
+    }
+
+  private:
+    static std::size_t size(const asio::streambuf &streambuf) noexcept {
+      return streambuf.size();
+    }
+    template <typename buffers_type>
+    static std::size_t size(const buffers_type &buffers) noexcept {
+      return asio::buffer_size(buffers);
+    }
+  };
+
+  /// TLS session resumption for a server context, so that a returning client skips the certificate and key exchange.
+  /// Sessions are kept in the OpenSSL cache, looked up by session id, and also handed to the clients as stateless
+  /// tickets. Ticket keys are generated in memory and replaced every key_rotation_seconds. A replaced key still decrypts
+  /// the tickets it issued until they expire, and those clients get a new ticket under the current key.
+  class TlsSessionResumption {
+    struct Key {
+      unsigned char name[16];
+      unsigned char aes_key[32];
+      unsigned char hmac_key[32];
+      std::chrono::steady_clock::time_point created;
+    };
+
+    Mutex mutex;
+    std::vector<Key> keys GUARDED_BY(mutex); // Newest first
+    long timeout_seconds = 0;
+    long key_rotation_seconds = 0;
+
+  public:
+    ~TlsSessionResumption() {
+      LockGuard lock(mutex);
+      for(auto &key : keys)
+        OPENSSL_cleanse(&key, sizeof(key));
+    }
+
+    /// Call once the context is set up and before any handshake. id_context must tell this server apart from others
+    /// that could share a client, e.g. its port and address. A cache_size of 0 disables the session id cache.
+    void enable(SSL_CTX *context, const std::string &id_context, std::size_t cache_size, long timeout_seconds, bool tickets, long key_rotation_seconds) {
+      SSL_CTX_set_session_id_context(context, reinterpret_cast<const unsigned char *>(id_context.data()),
+                                     static_cast<unsigned int>(std::min<std::size_t>(id_context.size(), SSL_MAX_SID_CTX_LENGTH)));
+
+      if(cache_size > 0) {
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(context, static_cast<long>(cache_size));
+      }
+      else
+        SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_OFF);
+      SSL_CTX_set_timeout(context, timeout_seconds);
+
+      if(tickets) {
+        this->timeout_seconds = timeout_seconds;
+        this->key_rotation_seconds = std::max(key_rotation_seconds, 1L);
+        SSL_CTX_clear_options(context, SSL_OP_NO_TICKET);
+        SSL_CTX_set_ex_data(context, ex_data_index(), this);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(context, ticket_key_callback);
+#else
+        SSL_CTX_set_tlsext_ticket_key_cb(context, ticket_key_callback);
+#endif
+      }
+      else
+        SSL_CTX_set_options(context, SSL_OP_NO_TICKET);
+    }
+
+  private:
+    static int ex_data_index() {
+      static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+      return index;
+    }
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+    using mac_context = EVP_MAC_CTX; // OpenSSL 3 deprecates the HMAC_CTX callback
+
+    static bool init_mac(mac_context *mac, const Key &key) {
+      OSSL_PARAM params[] = {OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, const_cast<char *>("SHA256"), 0), OSSL_PARAM_construct_end()};
+      return EVP_MAC_init(mac, key.hmac_key, sizeof(key.hmac_key), params) == 1;
+    }
+#else
+    using mac_context = HMAC_CTX;
+
+    static bool init_mac(mac_context *mac, const Key &key) {
+      return HMAC_Init_ex(mac, key.hmac_key, sizeof(key.hmac_key), EVP_sha256(), nullptr) == 1;
+    }
+#endif
+
+    /// Returns 1 to use the key, 2 to accept a ticket but issue a new one, 0 for an unknown key and -1 on error.
+    static int ticket_key_callback(SSL *ssl, unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, mac_context *mac, int encrypt) {
+      auto self = static_cast<TlsSessionResumption *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), ex_data_index()));
+      if(!self)
+        return -1;
+
+      Key key;
+      bool newest;
+      if(!self->find_key(encrypt ? nullptr : name, key, newest))
+        return encrypt ? -1 : 0; // An unknown or expired key falls back to a full handshake
+
+      int result = encrypt || newest ? 1 : 2;
+      if(encrypt) {
+        std::memcpy(name, key.name, sizeof(key.name));
+        if(RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) != 1 ||
+           EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1)
+          result = -1;
+      }
+      else if(EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes_key, iv) != 1)
+        result = -1;
+
+      if(result > 0 && !init_mac(mac, key))
+        result = -1;
+
+      OPENSSL_cleanse(&key, sizeof(key));
+      return result;
+    }
+
+    /// Copies the current key if name is null, else the key with the given name.
+    bool find_key(const unsigned char *name, Key &key, bool &newest) {
+      LockGuard lock(mutex);
+      rotate(std::chrono::steady_clock::now());
+
+      for(std::size_t i = 0; i < keys.size(); ++i) {
+        if(!name || std::memcmp(keys[i].name, name, sizeof(keys[i].name)) == 0) {
+          key = keys[i];
+          newest = i == 0;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    void rotate(std::chrono::steady_clock::time_point now) REQUIRES(mutex) {
+      if(keys.empty() || now - keys.front().created >= std::chrono::seconds(key_rotation_seconds)) {
+        Key key;
+        if(RAND_bytes(key.name, sizeof(key.name)) == 1 && RAND_bytes(key.aes_key, sizeof(key.aes_key)) == 1 &&
+           RAND_bytes(key.hmac_key, sizeof(key.hmac_key)) == 1) {
+          key.created = now;
+          keys.insert(keys.begin(), key);
+        }
+        OPENSSL_cleanse(&key, sizeof(key));
+      }
+
+      // A key stops issuing tickets when the next one is created, and its last tickets expire timeout_seconds later
+      for(std::size_t i = 1; i < keys.size(); ++i) {
+        if(now - keys[i - 1].created >= std::chrono::seconds(timeout_seconds)) {
+          for(auto it = keys.begin() + static_cast<std::ptrdiff_t>(i); it != keys.end(); ++it)
+            OPENSSL_cleanse(&*it, sizeof(*it));
+          keys.resize(i);
+          break;
+        }
+      }
+    }
+  };
+
+  /// TLS sessions of the client connections made with a context, one per server, so that connecting again to a server
+  /// resumes the last session instead of doing the full handshake. Sessions are stored as OpenSSL hands them over, which
+  /// also covers the tickets a TLS 1.3 server sends after the handshake. Clients sharing the context share the sessions.
+  class TlsClientSessionCache {
+    struct Sessions {
+      Mutex mutex;
+      std::unordered_map<std::string, SSL_SESSION *> map GUARDED_BY(mutex);
+
+      ~Sessions() {
+        LockGuard lock(mutex);
+        for(auto &session : map)
+          SSL_SESSION_free(session.second);
+      }
+    };
+
+  public:
+    /// Call once on a client context, before its first connection.
+    static void enable(SSL_CTX *context) {
+      if(SSL_CTX_get_ex_data(context, context_index()))
+        return;
+      SSL_CTX_set_ex_data(context, context_index(), new Sessions());
+      SSL_CTX_set_session_cache_mode(context, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+      SSL_CTX_sess_set_new_cb(context, new_session_callback);
+    }
+
+    /// Call before the handshake of ssl, with server naming what it connects to, e.g. host:port. Offers the session
+    /// cached for server, if it has not expired, and has the session that is negotiated stored in its place.
+    static void prepare(SSL *ssl, const std::string &server) {
+      auto sessions = static_cast<Sessions *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+      if(!sessions)
+        return;
+      SSL_set_ex_data(ssl, connection_index(), new std::string(server));
+
+      SSL_SESSION *session = nullptr;
+      {
+        LockGuard lock(sessions->mutex);
+        auto it = sessions->map.find(server);
+        if(it == sessions->map.end())
+          return;
+        if(SSL_SESSION_get_time(it->second) + SSL_SESSION_get_timeout(it->second) <= static_cast<long>(std::time(nullptr))) {
+          SSL_SESSION_free(it->second);
+          sessions->map.erase(it);
+          return;
+        }
+        session = it->second;
+        SSL_SESSION_up_ref(session);
+      }
+      SSL_set_session(ssl, session);
+      SSL_SESSION_free(session);
+    }
+
+    /// Drops the session cached for the server of ssl, e.g. after its handshake failed.
+    static void erase(SSL *ssl) {
+      auto sessions = static_cast<Sessions *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+      auto server = static_cast<std::string *>(SSL_get_ex_data(ssl, connection_index()));
+      if(!sessions || !server)
+        return;
+
+      LockGuard lock(sessions->mutex);
+      auto it = sessions->map.find(*server);
+      if(it != sessions->map.end()) {
+        SSL_SESSION_free(it->second);
+        sessions->map.erase(it);
+      }
+    }
+
+  private:
+    static int context_index() {
+      static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, [](void *, void *sessions, CRYPTO_EX_DATA *, int, long, void *) {
+        delete static_cast<Sessions *>(sessions);
+      });
+      return index;
+    }
+
+    static int connection_index() {
+      static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, [](void *, void *server, CRYPTO_EX_DATA *, int, long, void *) {
+        delete static_cast<std::string *>(server);
+      });
+      return index;
+    }
+
+    /// Returns 1 to keep the reference to session.
+    static int new_session_callback(SSL *ssl, SSL_SESSION *session) {
+      auto sessions = static_cast<Sessions *>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+      auto server = static_cast<std::string *>(SSL_get_ex_data(ssl, connection_index()));
+      if(!sessions || !server)
+        return 0;
+
+      LockGuard lock(sessions->mutex);
+      auto &cached = sessions->map[*server];
+      if(cached)
+        SSL_SESSION_free(cached);
+      cached = session;
+      return 1;
+    }
+  };
+
+  /// Threads that run the TLS handshakes of a server, so that the key exchange of new connections does not hold up the
+  /// threads serving established ones. The sockets stay on the serving io_service: the handshake completion handler is
+  /// bound to the pool, and the handshake steps run with it. Once the handshake is done, the connection is served as usual.
+  class TlsHandshakePool {
+    std::shared_ptr<io_context> io_service;
+    std::vector<std::thread> threads;
+
+  public:
+    ~TlsHandshakePool() noexcept {
+      stop();
+    }
+
+    /// With 0 threads, handshakes run on the serving threads.
+    void start(std::size_t thread_pool_size) {
+      stop();
+      if(thread_pool_size == 0)
+        return;
+
+      io_service = std::make_shared<io_context>();
+      for(std::size_t c = 0; c < thread_pool_size; c++) {
+        auto io_service = this->io_service;
+        threads.emplace_back([io_service] {
+          auto work = make_work_guard(*io_service);
+          io_service->run();
+        });
+      }
+    }
+
+    void stop() noexcept {
+      if(!io_service)
+        return;
+      io_service->stop();
+      for(auto &thread : threads)
+        thread.join();
+      threads.clear();
+      io_service.reset();
+    }
+
+    template <typename socket_type, typename handler_type>
+    void async_handshake(socket_type &socket, handler_type &&handler) {
+      if(!io_service) {
+        socket.async_handshake(asio::ssl::stream_base::server, std::forward<handler_type>(handler));
+        return;
+      }
+      auto io_service = this->io_service; // A pending handshake keeps the pool's io_service alive
+      socket.async_handshake(asio::ssl::stream_base::server, bind_executor(*io_service, [io_service, handler](const error_code &ec) {
+                               handler(ec);
+                             }));
+    }
+  };
+} // namespace SimpleWeb
+
+#endif /* SIMPLE_WEB_TLS_SESSION_HPP */
@@ -0,0 +1,137 @@
+#ifndef SIMPLE_WEB_TRACE_HPP
+#define SIMPLE_WEB_TRACE_HPP
+
+// Define SIMPLEWEB_ENABLE_TRACING to 1 to record the timings of every WebSocket message.
+// When it is 0, SIMPLEWEB_TRACE() expands to nothing and no tracing code is compiled.
+#ifndef SIMPLEWEB_ENABLE_TRACING
+#define SIMPLEWEB_ENABLE_TRACING 0
+#endif
+
+#if SIMPLEWEB_ENABLE_TRACING
+#define SIMPLEWEB_TRACE(...) __VA_ARGS__
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace SimpleWeb {
+  namespace trace {
+    /// Monotonic timestamp in nanoseconds.
+    inline std::int64_t now() noexcept {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Timings of one message.
+    /// Inbound: start=read complete, middle=dispatch start, end=dispatch end.
+    /// Outbound: start=enqueued, end=write complete (middle is unused).
+    struct Record {
+      bool inbound;
+      unsigned char fin_rsv_opcode;
+      std::uint64_t size;
+      const void *connection;
+      std::int64_t start, middle, end;
+    };
+
+    /// Fixed size ring of the last records. Writers never block: each one claims a slot with a single fetch_add and
+    /// publishes it with a sequence number, so that readers can skip slots that are being overwritten.
+    class Ring {
+    public:
+      static constexpr std::size_t capacity = 1 << 14;
+
+      void push(const Record &record) noexcept {
+        auto index = head.fetch_add(1, std::memory_order_relaxed);
+        auto &slot = slots[index & (capacity - 1)];
+        slot.sequence.store(2 * index + 1, std::memory_order_relaxed); // Odd while writing
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.record = record;
+        slot.sequence.store(2 * index + 2, std::memory_order_release);
+      }
+
+      void push_inbound(const void *connection, unsigned char fin_rsv_opcode, std::uint64_t size, std::int64_t read_complete, std::int64_t dispatch_start, std::int64_t dispatch_end) noexcept {
+        push(Record{true, fin_rsv_opcode, size, connection, read_complete, dispatch_start, dispatch_end});
+      }
+
+      void push_outbound(const void *connection, unsigned char fin_rsv_opcode, std::uint64_t size, std::int64_t enqueued, std::int64_t write_complete) noexcept {
+        push(Record{false, fin_rsv_opcode, size, connection, enqueued, write_complete, write_complete});
+      }
+
+      /// Copies the complete records currently in the ring, oldest first.
+      std::vector<Record> snapshot() const {
+        std::vector<Record> records;
+        auto last = head.load(std::memory_order_acquire);
+        auto first = last > capacity ? last - capacity : 0;
+        records.reserve(static_cast<std::size_t>(last - first));
+        for(auto index = first; index < last; ++index) {
+          auto &slot = slots[index & (capacity - 1)];
+          auto sequence = slot.sequence.load(std::memory_order_acquire);
+          if(sequence != 2 * index + 2)
+            continue;
+          Record record = slot.record;
+          std::atomic_thread_fence(std::memory_order_acquire);
+          if(slot.sequence.load(std::memory_order_relaxed) == sequence)
+            records.emplace_back(record);
+        }
+        return records;
+      }
+
+      /// Returns the records in the Chrome trace-event format, to be loaded in chrome://tracing or Perfetto.
+      /// Each connection is shown as a thread.
+      std::string to_chrome_json() const {
+        auto records = snapshot();
+        std::map<const void *, int> connection_ids;
+        std::ostringstream json;
+        json << "{\"traceEvents\":[";
+        bool first = true;
+        auto event = [&](const char *name, const char *category, const Record &record, std::int64_t begin, std::int64_t end) {
+          auto id = connection_ids.emplace(record.connection, static_cast<int>(connection_ids.size()) + 1).first->second;
+          json << (first ? "" : ",") << "\n{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << id
+               << ",\"ts\":" << begin / 1000.0 << ",\"dur\":" << (end - begin) / 1000.0
+               << ",\"args\":{\"opcode\":" << (record.fin_rsv_opcode & 0x0f) << ",\"size\":" << record.size << "}}";
+          first = false;
+        };
+        json.precision(15);
+        for(auto &record : records) {
+          if(record.inbound) {
+            event("read to dispatch", "inbound", record, record.start, record.middle);
+            event("dispatch", "inbound", record, record.middle, record.end);
+          }
+          else
+            event("send queue", "outbound", record, record.start, record.end);
+        }
+        json << "\n]}";
+        return json.str();
+      }
+
+      void clear() noexcept {
+        for(auto &slot : slots)
+          slot.sequence.store(0, std::memory_order_relaxed);
+        head.store(0, std::memory_order_release);
+      }
+
+    private:
+      struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        Record record;
+      };
+
+      std::atomic<std::uint64_t> head{0};
+      Slot slots[capacity];
+    };
+
+    /// The process wide ring that the servers record to.
+    inline Ring &ring() {
+      static Ring instance;
+      return instance;
+    }
+  } // namespace trace
+} // namespace SimpleWeb
+
+#else
+#define SIMPLEWEB_TRACE(...)
+#endif
+
+#endif /* SIMPLE_WEB_TRACE_HPP */
@@ -0,0 +1,66 @@
+#ifndef SIMPLE_WEB_WEBSOCKET_FRAME_HPP
+#define SIMPLE_WEB_WEBSOCKET_FRAME_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+namespace SimpleWeb {
+  /// WebSocket frame encoding shared by the server and the client, see https://tools.ietf.org/html/rfc6455#section-5.2.
+  class WebSocketFrame {
+  public:
+    /// Largest header: 2 bytes, 8 bytes of extended length and 4 bytes of mask.
+    static constexpr std::size_t max_header_size = 14;
+
+    /// Writes the header of a frame with the given payload length to destination, which must have room for max_header_size bytes.
+    /// The frame is masked if mask is not nullptr. Returns the number of bytes written.
+    static std::size_t write_header(unsigned char *destination, unsigned char fin_rsv_opcode, std::size_t length, const unsigned char *mask = nullptr) noexcept {
+      unsigned char mask_bit = mask ? 128 : 0;
+      std::size_t size = 0;
+      destination[size++] = fin_rsv_opcode;
+      if(length >= 126) {
+        std::size_t num_bytes;
+        if(length > 0xffff) {
+          num_bytes = 8;
+          destination[size++] = 127 | mask_bit;
+        }
+        else {
+          num_bytes = 2;
+          destination[size++] = 126 | mask_bit;
+        }
+
+        for(std::size_t c = num_bytes - 1; c != static_cast<std::size_t>(-1); c--)
+          destination[size++] = static_cast<unsigned char>(static_cast<unsigned long long>(length) >> (8 * c));
+      }
+      else
+        destination[size++] = static_cast<unsigned char>(length) | mask_bit;
+
+      if(mask) {
+        std::memcpy(destination + size, mask, 4);
+        size += 4;
+      }
+      return size;
+    }
+
+    /// XORs size bytes of source with the mask into destination, which may be the same as source.
+    /// The first byte is masked with mask[0]. Works on 8 bytes at a time, which compilers vectorize further.
+    static void apply_mask(const char *source, char *destination, std::size_t size, const std::array<unsigned char, 4> &mask) noexcept {
+      std::size_t c = 0;
+      if(size >= 16) {
+        unsigned char mask_bytes[8] = {mask[0], mask[1], mask[2], mask[3], mask[0], mask[1], mask[2], mask[3]};
+        std::uint64_t mask_word;
+        std::memcpy(&mask_word, mask_bytes, 8);
+        for(; c + 8 <= size; c += 8) {
+          std::uint64_t word;
+          std::memcpy(&word, source + c, 8);
+          word ^= mask_word;
+          std::memcpy(destination + c, &word, 8);
+        }
+      }
+      for(; c < size; c++)
+        destination[c] = static_cast<char>(source[c] ^ mask[c % 4]);
+    }
+  };
+} // namespace SimpleWeb
+
+#endif /* SIMPLE_WEB_WEBSOCKET_FRAME_HPP */
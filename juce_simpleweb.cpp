@@ -21,4 +21,9 @@
 //==============================================================================
 #include "common/WSCrypto.cpp"
 #include  "MIMETypes.cpp"
+#include "IORuntime.cpp"
+#include "JSONView.cpp"
+#include "MessagePack.cpp"
+#include "ServerMetrics.cpp"
+#include "ServerSentEvents.cpp"
 #include "SimpleWebSocketServer.cpp"
@@ -49,6 +49,14 @@
 #include <juce_core/juce_core.h>
 #include <juce_cryptography/juce_cryptography.h>
 
+/** Config: SIMPLEWEB_ENABLE_TRACING
+	Records when each WebSocket message is read, dispatched and sent, in a ring buffer that can be written
+	as Chrome trace-event JSON with SimpleWebSocketServerBase::writeTrace(). Compiled out when disabled.
+*/
+#ifndef SIMPLEWEB_ENABLE_TRACING
+ #define SIMPLEWEB_ENABLE_TRACING 0
+#endif
+
 //#ifndef __arm__
 #define SIMPLEWEB_SECURE_SUPPORTED 1
 //#else
@@ -76,6 +84,13 @@
 #include "websocket/client_ws.hpp"
 #endif
 
+#include "IORuntime.h"
+#include "WebSocketPayload.h"
+#include "JSONView.h"
+#include "MessagePack.h"
+#include "ServerMetrics.h"
+#include "ServerSentEvents.h"
 #include "SimpleWebSocketServer.h"
 #include "SimpleWebSocketClient.h"
+#include "WebSocketRPC.h"
 #include "MIMETypes.h"
@@ -1,2 +1,3 @@
 #include "juce_simpleweb.h"
 #include "SimpleWebSocketClient.cpp"
+#include "WebSocketRPC.cpp"
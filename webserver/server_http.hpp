@@ -2,16 +2,30 @@
 #define SIMPLE_WEB_SERVER_HTTP_HPP
 
 #include "../common/asio_compatibility.hpp"
+#include "../common/local_socket.hpp"
 #include "../common/mutex.hpp"
 #include "../common/utility.hpp"
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <limits>
 #include <list>
 #include <map>
 #include <sstream>
+#include <stdexcept>
 #include <thread>
 #include <unordered_set>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #pragma warning(disable:4456)
 
@@ -48,14 +62,99 @@ namespace SimpleWeb {
 
 			std::shared_ptr<Session> session;
 			long timeout_content;
+			int status = 0;
+
+			/// A file queued by send_file(). It goes to the socket with sendfile() where the socket allows it, else it is
+			/// read and written in parts.
+			class FileSource {
+			public:
+				std::uint64_t remaining = 0;
+				std::vector<char> part;
+#ifdef __linux__
+				int fd = -1;
+				off_t offset = 0;
+
+				~FileSource() {
+					if (fd >= 0)
+						::close(fd);
+				}
+
+				bool open(const std::string& path) {
+					struct stat status;
+					fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+					if (fd < 0 || ::fstat(fd, &status) != 0)
+						return false;
+					remaining = static_cast<std::uint64_t>(status.st_size);
+					return true;
+				}
+
+				std::size_t read(char* data, std::size_t size) {
+					auto n = ::pread(fd, data, size, offset);
+					if (n <= 0)
+						return 0;
+					offset += n;
+					return static_cast<std::size_t>(n);
+				}
+#else
+				std::ifstream stream;
+
+				bool open(const std::string& path) {
+					stream.open(path, std::ios::binary | std::ios::ate);
+					if (!stream.is_open())
+						return false;
+					remaining = static_cast<std::uint64_t>(stream.tellg());
+					stream.seekg(0);
+					return true;
+				}
+
+				std::size_t read(char* data, std::size_t size) {
+					stream.read(data, static_cast<std::streamsize>(size));
+					return static_cast<std::size_t>(stream.gcount());
+				}
+#endif
+			};
+
+			/// Either a stream buffer owned by this response, a buffer shared with other responses, or a file.
+			struct SendItem {
+				std::shared_ptr<asio::streambuf> streambuf;
+				std::shared_ptr<const std::string> buffer;
+				std::function<void(const error_code&)> callback;
+				std::shared_ptr<FileSource> file;
+			};
 
 			Mutex send_queue_mutex;
-			std::list<std::pair<std::shared_ptr<asio::streambuf>, std::function<void(const error_code&)>>> send_queue GUARDED_BY(send_queue_mutex);
+			std::list<SendItem> send_queue GUARDED_BY(send_queue_mutex);
 
 			Response(std::shared_ptr<Session> session_, long timeout_content) noexcept : std::ostream(nullptr), session(std::move(session_)), timeout_content(timeout_content) {
 				rdbuf(streambuf.get());
 			}
 
+			/// Prepares a recycled Response for a new request, keeping the allocated stream buffer.
+			void reset(std::shared_ptr<Session> session_, long timeout_content_) noexcept {
+				session = std::move(session_);
+				timeout_content = timeout_content_;
+				if (streambuf)
+					streambuf->consume(streambuf->size());
+				else
+					streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
+				rdbuf(streambuf.get());
+				clear();
+				close_connection_after_response = false;
+				status = 0;
+			}
+
+			/// Reads the status code from the status line at the start of the response, before it is sent.
+			void read_status() noexcept {
+				if (status != 0 || streambuf->size() < 12)
+					return;
+				auto data = static_cast<const char*>(streambuf->data().data());
+				if (std::strncmp(data, "HTTP/", 5) != 0)
+					return;
+				auto space = static_cast<const char*>(std::memchr(data, ' ', streambuf->size() - 3));
+				if (space && std::isdigit(space[1]) && std::isdigit(space[2]) && std::isdigit(space[3]))
+					status = (space[1] - '0') * 100 + (space[2] - '0') * 10 + (space[3] - '0');
+			}
+
 			template <typename size_type>
 			void write_header(const CaseInsensitiveMultimap& header, size_type size) {
 				bool content_length_written = false;
@@ -76,7 +175,7 @@ namespace SimpleWeb {
 
 			void send_from_queue() REQUIRES(send_queue_mutex) {
 				auto self = this->shared_from_this();
-				asio::async_write(*self->session->connection->socket, *send_queue.begin()->first, [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
+				auto handler = [self](const error_code& ec, std::size_t /*bytes_transferred*/) {
 					auto lock = self->session->connection->handler_runner->continue_lock();
 					if (!lock)
 						return;
@@ -84,7 +183,7 @@ namespace SimpleWeb {
 						LockGuard lock(self->send_queue_mutex);
 						if (!ec) {
 							auto it = self->send_queue.begin();
-							auto callback = std::move(it->second);
+							auto callback = std::move(it->callback);
 							self->send_queue.erase(it);
 							if (self->send_queue.size() > 0)
 								self->send_from_queue();
@@ -96,9 +195,9 @@ namespace SimpleWeb {
 						else {
 							// All handlers in the queue is called with ec:
 							std::vector<std::function<void(const error_code&)>> callbacks;
-							for (auto& pair : self->send_queue) {
-								if (pair.second)
-									callbacks.emplace_back(std::move(pair.second));
+							for (auto& item : self->send_queue) {
+								if (item.callback)
+									callbacks.emplace_back(std::move(item.callback));
 							}
 							self->send_queue.clear();
 
@@ -107,12 +206,79 @@ namespace SimpleWeb {
 								callback(ec);
 						}
 					}
+				};
+				auto& item = *send_queue.begin();
+				if (item.file) {
+					// The first part is sent from a completion handler, since handler must not be called while send_queue_mutex is held
+					auto file = item.file;
+					async_wait_writable(session->connection->socket->lowest_layer(), [self, file, handler](const error_code& ec) {
+						if (ec)
+							handler(ec, 0);
+						else
+							self->send_file_part(file, handler);
+					});
+				}
+				else if (item.buffer)
+					SocketWriter<socket_type>::async_write(*session->connection->socket, asio::buffer(*item.buffer), handler);
+				else
+					SocketWriter<socket_type>::async_write(*session->connection->socket, *item.streambuf, handler);
+			}
+
+			template <typename handler_type>
+			void send_file_part(const std::shared_ptr<FileSource>& file, const handler_type& handler) {
+				if (file->remaining == 0) {
+					handler(error_code(), 0);
+					return;
+				}
+				auto self = this->shared_from_this();
+#ifdef __linux__
+				if (auto socket = SocketWriter<socket_type>::sendfile_socket(*session->connection->socket)) {
+					error_code ec;
+					socket->native_non_blocking(true, ec);
+					while (file->remaining > 0) {
+						auto n = ::sendfile(socket->native_handle(), file->fd, &file->offset, static_cast<std::size_t>(std::min<std::uint64_t>(file->remaining, 1 << 30)));
+						if (n > 0)
+							file->remaining -= static_cast<std::uint64_t>(n);
+						else if (n < 0 && errno == EINTR)
+							continue;
+						else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+							async_wait_writable(*socket, [self, file, handler](const error_code& ec) {
+								if (ec)
+									handler(ec, 0);
+								else
+									self->send_file_part(file, handler);
+							});
+							return;
+						}
+						else {
+							handler(make_error_code::make_error_code(errc::io_error), 0);
+							return;
+						}
+					}
+					handler(error_code(), 0);
+					return;
+				}
+#endif
+				if (file->part.empty())
+					file->part.resize(64 * 1024);
+				auto size = file->read(file->part.data(), static_cast<std::size_t>(std::min<std::uint64_t>(file->remaining, file->part.size())));
+				if (size == 0) {
+					handler(make_error_code::make_error_code(errc::io_error), 0);
+					return;
+				}
+				file->remaining -= size;
+				SocketWriter<socket_type>::async_write(*session->connection->socket, asio::buffer(file->part.data(), size), [self, file, handler](const error_code& ec, std::size_t /*bytes_transferred*/) {
+					if (ec || file->remaining == 0)
+						handler(ec, 0);
+					else
+						self->send_file_part(file, handler);
 				});
 			}
 
 			void send_on_delete(const std::function<void(const error_code&)>& callback = nullptr) noexcept {
+				read_status();
 				auto self = this->shared_from_this(); // Keep Response instance alive through the following async_write
-				asio::async_write(*session->connection->socket, *streambuf, [self, callback](const error_code& ec, std::size_t /*bytes_transferred*/) {
+				SocketWriter<socket_type>::async_write(*session->connection->socket, *streambuf, [self, callback](const error_code& ec, std::size_t /*bytes_transferred*/) {
 					auto lock = self->session->connection->handler_runner->continue_lock();
 					if (!lock)
 						return;
@@ -130,16 +296,74 @@ namespace SimpleWeb {
 			///
 			/// Use this function if you need to recursively send parts of a longer message, or when using server-sent events.
 			void send(std::function<void(const error_code&)> callback = nullptr) noexcept {
+				read_status();
 				std::shared_ptr<asio::streambuf> streambuf = std::move(this->streambuf);
 				this->streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
 				rdbuf(this->streambuf.get());
 
 				LockGuard lock(send_queue_mutex);
-				send_queue.emplace_back(std::move(streambuf), std::move(callback));
+				send_queue.emplace_back(SendItem{std::move(streambuf), nullptr, std::move(callback), nullptr});
 				if (send_queue.size() == 1)
 					send_from_queue();
 			}
 
+			/// Send a buffer that can be shared with other responses without being copied, for instance an event
+			/// broadcast to many server-sent events subscribers. Content written to the response stream is sent first.
+			/// The callback is called when the send has completed.
+			void send_buffer(std::shared_ptr<const std::string> buffer, std::function<void(const error_code&)> callback = nullptr) noexcept {
+				read_status();
+				std::shared_ptr<asio::streambuf> streambuf;
+				if (this->streambuf->size() > 0) {
+					streambuf = std::move(this->streambuf);
+					this->streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
+					rdbuf(this->streambuf.get());
+				}
+
+				LockGuard lock(send_queue_mutex);
+				auto idle = send_queue.empty();
+				if (streambuf)
+					send_queue.emplace_back(SendItem{std::move(streambuf), nullptr, nullptr, nullptr});
+				send_queue.emplace_back(SendItem{nullptr, std::move(buffer), std::move(callback), nullptr});
+				if (idle)
+					send_from_queue();
+			}
+
+			/// Send a file after the content written so far, without loading it in memory. On Linux, the kernel copies it to
+			/// the socket with sendfile(), for HTTP and for HTTPS with Config::kernel_tls. The callback is called when the
+			/// send has completed. If the file can't be opened, the callback is called with the error right away, and the
+			/// connection is closed after the response since its header may already announce the file.
+			void send_file(const std::string& path, std::function<void(const error_code&)> callback = nullptr) noexcept {
+				auto file = std::make_shared<FileSource>();
+				if (!file->open(path)) {
+					close_connection_after_response = true;
+					if (callback)
+						callback(make_error_code::make_error_code(errc::no_such_file_or_directory));
+					return;
+				}
+
+				read_status();
+				std::shared_ptr<asio::streambuf> streambuf;
+				if (this->streambuf->size() > 0) {
+					streambuf = std::move(this->streambuf);
+					this->streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
+					rdbuf(this->streambuf.get());
+				}
+
+				LockGuard lock(send_queue_mutex);
+				auto idle = send_queue.empty();
+				if (streambuf)
+					send_queue.emplace_back(SendItem{std::move(streambuf), nullptr, nullptr, nullptr});
+				send_queue.emplace_back(SendItem{nullptr, nullptr, std::move(callback), std::move(file)});
+				if (idle)
+					send_from_queue();
+			}
+
+			/// Number of sends that have not completed yet.
+			std::size_t send_queue_size() noexcept {
+				LockGuard lock(send_queue_mutex);
+				return send_queue.size();
+			}
+
 			/// Write directly to stream buffer using std::ostream::write.
 			void write(const char_type* ptr, std::streamsize n) {
 				std::ostream::write(ptr, n);
@@ -186,6 +410,12 @@ namespace SimpleWeb {
 			}
 
 
+			/// Cancels the timeout of the connection, Config::timeout_content, for responses that stay open for as long as
+			/// the client wants, such as event streams.
+			void cancel_timeout() noexcept {
+				session->connection->cancel_timeout();
+			}
+
 			/// If set to true, force server to close the connection after the response have been sent.
 			///
 			/// This is useful when implementing a HTTP/1.0-server sending content
@@ -221,6 +451,20 @@ namespace SimpleWeb {
 
 			Request(std::size_t max_request_streambuf_size, const std::shared_ptr<Connection>& connection_) noexcept : streambuf(max_request_streambuf_size), connection(connection_), content(streambuf) {}
 
+			/// Clears the request so that it can be reused for the next request on the same connection.
+			/// Allocated buffers and containers are kept.
+			void reset() noexcept {
+				streambuf.consume(streambuf.size());
+				content.clear();
+				method.clear();
+				path.clear();
+				query_string.clear();
+				http_version.clear();
+				header.clear();
+				path_match = regex::smatch();
+				header_read_time = std::chrono::system_clock::time_point();
+			}
+
 		public:
 			std::string method, path, query_string, http_version;
 
@@ -237,7 +481,7 @@ namespace SimpleWeb {
 			asio::ip::tcp::endpoint remote_endpoint() const noexcept {
 				try {
 					if (auto connection = this->connection.lock())
-						return connection->socket->lowest_layer().remote_endpoint();
+						return LocalSocket::remote_endpoint(connection->socket->lowest_layer());
 				}
 				catch (...) {
 				}
@@ -282,12 +526,31 @@ namespace SimpleWeb {
 			}
 		};
 
+		/// Receives a request body part by part as it arrives, instead of having it buffered in Request::content.
+		/// Set through ServerBase::on_request_body.
+		class BodyStream {
+		public:
+			/// Called for each received part of the body. data is only valid until resume is called.
+			/// The next part is not read from the socket before resume has been called, which can be done later
+			/// and from another thread to apply backpressure on the client.
+			std::function<void(const char* data, std::size_t size, std::function<void()> resume)> on_data;
+			/// Called when the whole body has been received, right before the resource function is called.
+			std::function<void()> on_end;
+			/// Called if the body could not be read completely.
+			std::function<void(const error_code&)> on_error;
+		};
+
 	protected:
 		class Connection : public std::enable_shared_from_this<Connection> {
 		public:
 			template <typename... Args>
 			Connection(std::shared_ptr<ScopeRunner> handler_runner_, Args &&...args) noexcept : handler_runner(std::move(handler_runner_)), socket(new socket_type(std::forward<Args>(args)...)) {}
 
+			~Connection() noexcept {
+				if (socket)
+					ConnectionTeardown<socket_type>::before_destroy(*socket);
+			}
+
 			std::shared_ptr<ScopeRunner> handler_runner;
 
 			std::unique_ptr<socket_type> socket; // Socket must be unique_ptr since asio::ssl::stream<asio::ip::tcp::socket> is not movable
@@ -333,6 +596,7 @@ namespace SimpleWeb {
 
 			std::shared_ptr<Connection> connection;
 			std::shared_ptr<Request> request;
+			std::shared_ptr<BodyStream> body_stream;
 		};
 
 	public:
@@ -361,6 +625,41 @@ namespace SimpleWeb {
 			bool reuse_address = true;
 			/// Make use of RFC 7413 or TCP Fast Open (TFO)
 			bool fast_open = false;
+			/// Maximum number of Response objects that each io thread keeps for reuse. Set to 0 to disable pooling.
+			std::size_t response_pool_size = 32;
+			/// Request and Response buffers that have grown beyond this size are released instead of being reused
+			/// for the next keep-alive request.
+			std::size_t max_pooled_buffer_size = 64 * 1024;
+			/// Maximum size of the parts handed to a BodyStream. Defaults to 64 kB.
+			std::size_t body_stream_chunk_size = 64 * 1024;
+			/// HTTPS only: number of TLS sessions kept for resumption by session id. Set to 0 to disable the cache.
+			std::size_t tls_session_cache_size = 20 * 1024;
+			/// HTTPS only: seconds during which a TLS session can be resumed, from the cache or a ticket. Defaults to 2 hours.
+			long tls_session_timeout = 7200;
+			/// HTTPS only: hand out stateless session tickets, which resume without any state kept on the server.
+			bool tls_session_tickets = true;
+			/// HTTPS only: seconds after which a new session ticket key is used. Defaults to 1 hour.
+			long tls_ticket_key_rotation = 3600;
+			/// HTTPS only: number of threads running TLS handshakes, apart from the threads serving established connections.
+			/// Defaults to 0, which runs the handshakes on the serving threads.
+			std::size_t handshake_thread_pool_size = 0;
+			/// HTTPS only: on Linux, have the kernel encrypt what is sent once the handshake is done, which also lets
+			/// Response::send_file() use sendfile(). Needs the tls kernel module and an AES-GCM cipher, otherwise
+			/// connections silently stay with OpenSSL. Defaults to false.
+			bool kernel_tls = false;
+			/// HTTPS only: size of the TLS records written at the start of a connection and after it has been idle, so that the
+			/// client can decrypt the first bytes of a message early, e.g. 1400 to fit in a TCP segment. Records grow to 16 kB once
+			/// tls_record_ramp_bytes have been sent. Defaults to 0, which always writes full records.
+			std::size_t tls_initial_record_size = 0;
+			/// HTTPS only: bytes written with small records before switching to full ones. Defaults to 1 MB.
+			std::size_t tls_record_ramp_bytes = 1024 * 1024;
+			/// HTTPS only: milliseconds without writes after which a connection starts over with small records. Defaults to 1 second.
+			long tls_record_idle_reset = 1000;
+			/// HTTP only: path of a Unix domain socket to listen on as well, for clients on the same host, see LocalSocket.
+			/// A socket file left at the path by an earlier run is removed. Empty to disable. Not available on Windows.
+			std::string unix_socket_path;
+			/// Set to false to only listen on unix_socket_path. The start() callback is then given port 0.
+			bool listen_tcp = true;
 		};
 		/// Set before calling start().
 		Config config;
@@ -388,6 +687,23 @@ namespace SimpleWeb {
 		/// Called when an error occurs.
 		std::function<void(std::shared_ptr<typename ServerBase<socket_type>::Request>, const error_code&)> on_error;
 
+		/// Called when the header of a request with a body has been read, before any of the body is read.
+		/// Return a status other than success_ok to reject the request: the status is sent and the connection is closed
+		/// without reading the body. Clients that sent Expect: 100-continue are told to go ahead only if the request is accepted.
+		/// Set body_stream to receive the body part by part instead of having it buffered in Request::content; the
+		/// max_request_streambuf_size limit then only applies to the size of each part.
+		std::function<StatusCode(std::shared_ptr<typename ServerBase<socket_type>::Request>, std::shared_ptr<BodyStream>&)> on_request_body;
+
+		/// Called when a connection has been accepted.
+		std::function<void()> on_accept;
+
+		/// Called when the TLS handshake of an accepted connection has succeeded or failed, and whether it resumed an earlier session.
+		/// Only used by HTTPS servers, and called on a handshake thread if Config::handshake_thread_pool_size is set.
+		std::function<void(const error_code&, bool /*resumed*/)> on_handshake;
+
+		/// Called when a response has been sent, or failed to be sent, with the status code of its status line.
+		std::function<void(std::shared_ptr<typename ServerBase<socket_type>::Request>, int /*status_code*/, const error_code&)> on_response;
+
 		/// Called on upgrade requests.
 		std::function<void(std::unique_ptr<socket_type>&, std::shared_ptr<typename ServerBase<socket_type>::Request>)> on_upgrade;
 
@@ -401,12 +717,6 @@ namespace SimpleWeb {
 		void start(const std::function<void(unsigned short /*port*/)>& callback = nullptr) {
 			std::unique_lock<std::mutex> lock(start_stop_mutex);
 
-			asio::ip::tcp::endpoint endpoint;
-			if (!config.address.empty())
-				endpoint = asio::ip::tcp::endpoint(make_address(config.address), config.port);
-			else
-				endpoint = asio::ip::tcp::endpoint(asio::ip::tcp::v6(), config.port);
-
 			if (!io_service) {
 				io_service = std::make_shared<io_context>();
 				internal_io_service = true;
@@ -414,33 +724,46 @@ namespace SimpleWeb {
 
 			if (!acceptor)
 				acceptor = std::unique_ptr<asio::ip::tcp::acceptor>(new asio::ip::tcp::acceptor(*io_service));
-			try {
-				acceptor->open(endpoint.protocol());
-			}
-			catch (const system_error& error) {
-				if (error.code() == asio::error::address_family_not_supported && config.address.empty()) {
-					endpoint = asio::ip::tcp::endpoint(asio::ip::tcp::v4(), config.port);
+
+			unsigned short port = 0;
+			if (config.listen_tcp) {
+				asio::ip::tcp::endpoint endpoint;
+				if (!config.address.empty())
+					endpoint = asio::ip::tcp::endpoint(make_address(config.address), config.port);
+				else
+					endpoint = asio::ip::tcp::endpoint(asio::ip::tcp::v6(), config.port);
+
+				try {
 					acceptor->open(endpoint.protocol());
 				}
-				else
-					throw;
-			}
-			acceptor->set_option(asio::socket_base::reuse_address(config.reuse_address));
-			if (config.fast_open) {
+				catch (const system_error& error) {
+					if (error.code() == asio::error::address_family_not_supported && config.address.empty()) {
+						endpoint = asio::ip::tcp::endpoint(asio::ip::tcp::v4(), config.port);
+						acceptor->open(endpoint.protocol());
+					}
+					else
+						throw;
+				}
+				acceptor->set_option(asio::socket_base::reuse_address(config.reuse_address));
+				if (config.fast_open) {
 #if defined(__linux__) && defined(TCP_FASTOPEN)
-				const int qlen = 5; // This seems to be the value that is used in other examples.
-				error_code ec;
-				acceptor->set_option(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_FASTOPEN>(qlen), ec);
+					const int qlen = 5; // This seems to be the value that is used in other examples.
+					error_code ec;
+					acceptor->set_option(asio::detail::socket_option::integer<IPPROTO_TCP, TCP_FASTOPEN>(qlen), ec);
 #endif // End Linux
-			}
-			acceptor->bind(endpoint);
+				}
+				acceptor->bind(endpoint);
+
+				after_bind();
 
-			after_bind();
+				port = acceptor->local_endpoint().port();
 
-			auto port = acceptor->local_endpoint().port();
+				acceptor->listen();
+				accept();
+			}
 
-			acceptor->listen();
-			accept();
+			if (!config.unix_socket_path.empty())
+				listen_local();
 
 			if (internal_io_service && io_service->stopped())
 				restart(*io_service);
@@ -480,6 +803,10 @@ namespace SimpleWeb {
 			if (acceptor) {
 				error_code ec;
 				acceptor->close(ec);
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+				if (local_acceptor)
+					LocalSocket::close(*local_acceptor);
+#endif
 
 				{
 					LockGuard _lock(connections->mutex);
@@ -504,6 +831,9 @@ namespace SimpleWeb {
 		bool internal_io_service = false;
 
 		std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+		std::unique_ptr<LocalSocket::protocol_type::acceptor> local_acceptor;
+#endif
 		std::vector<std::thread> threads;
 
 		struct Connections {
@@ -519,6 +849,23 @@ namespace SimpleWeb {
 		virtual void after_bind() {}
 		virtual void accept() = 0;
 
+		/// Listens on config.unix_socket_path, and accepts its connections with accept_local().
+		void listen_local() {
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+			if (!local_acceptor)
+				local_acceptor = std::unique_ptr<LocalSocket::protocol_type::acceptor>(new LocalSocket::protocol_type::acceptor(*io_service));
+			LocalSocket::listen(*io_service, *local_acceptor, config.unix_socket_path);
+			accept_local();
+#else
+			throw std::invalid_argument("Unix domain sockets are not supported on this platform");
+#endif
+		}
+
+		/// Accepts a connection on local_acceptor and moves it into a new connection, see LocalSocket.
+		virtual void accept_local() {
+			throw std::invalid_argument("unix_socket_path is only supported by HTTP servers");
+		}
+
 		template <typename... Args>
 		std::shared_ptr<Connection> create_connection(Args &&...args) noexcept {
 			auto connections = this->connections;
@@ -573,11 +920,10 @@ namespace SimpleWeb {
 								this->on_error(session->request, make_error_code::make_error_code(errc::protocol_error));
 							return;
 						}
-						if (content_length > session->request->streambuf.max_size()) {
-							auto response = std::shared_ptr<Response>(new Response(session, this->config.timeout_content));
-							response->write(StatusCode::client_error_payload_too_large);
-							if (this->on_error)
-								this->on_error(session->request, make_error_code::make_error_code(errc::message_size));
+						if (content_length > 0 && !this->accept_body(session, content_length))
+							return;
+						if (session->body_stream) {
+							this->read_body_stream(session, content_length);
 							return;
 						}
 						if (content_length > num_additional_bytes) {
@@ -596,6 +942,9 @@ namespace SimpleWeb {
 							this->find_resource(session);
 					}
 					else if ((header_it = session->request->header.find("Transfer-Encoding")) != session->request->header.end() && header_it->second == "chunked") {
+						if (!this->accept_body(session, 0))
+							return;
+
 						// Expect hex number to not exceed 16 bytes (64-bit number), but take into account previous additional read bytes
 						auto chunk_size_streambuf = std::make_shared<asio::streambuf>(std::max<std::size_t>(16 + 2, session->request->streambuf.size()));
 
@@ -637,13 +986,12 @@ namespace SimpleWeb {
 					}
 
 					if (chunk_size == 0) {
-						this->find_resource(session);
+						this->end_body(session);
 						return;
 					}
 
 					if (chunk_size + session->request->streambuf.size() > session->request->streambuf.max_size()) {
-						auto response = std::shared_ptr<Response>(new Response(session, this->config.timeout_content));
-						response->write(StatusCode::client_error_payload_too_large);
+						this->reject(session, StatusCode::client_error_payload_too_large);
 						if (this->on_error)
 							this->on_error(session->request, make_error_code::make_error_code(errc::message_size));
 						return;
@@ -674,13 +1022,13 @@ namespace SimpleWeb {
 									if (!lock)
 										return;
 									if (!ec)
-										read_chunked_transfer_encoded(session, chunk_size_streambuf);
+										this->forward_body(session, [this, session, chunk_size_streambuf] { this->read_chunked_transfer_encoded(session, chunk_size_streambuf); });
 									else
-										this->on_error(session->request, ec);
+										this->body_error(session, ec);
 								});
 							}
-							else if (this->on_error)
-								this->on_error(session->request, ec);
+							else
+								this->body_error(session, ec);
 						});
 					}
 					else if (2 + chunk_size > num_additional_bytes) { // If only end of chunk remains unread (\n or \r\n)
@@ -693,9 +1041,9 @@ namespace SimpleWeb {
 							if (!lock)
 								return;
 							if (!ec)
-								read_chunked_transfer_encoded(session, chunk_size_streambuf);
+								this->forward_body(session, [this, session, chunk_size_streambuf] { this->read_chunked_transfer_encoded(session, chunk_size_streambuf); });
 							else
-								this->on_error(session->request, ec);
+								this->body_error(session, ec);
 						});
 					}
 					else {
@@ -703,14 +1051,132 @@ namespace SimpleWeb {
 						istream.get();
 						istream.get();
 
-						read_chunked_transfer_encoded(session, chunk_size_streambuf);
+						this->forward_body(session, [this, session, chunk_size_streambuf] { this->read_chunked_transfer_encoded(session, chunk_size_streambuf); });
 					}
 				}
-				else if (this->on_error)
-					this->on_error(session->request, ec);
+				else
+					this->body_error(session, ec);
 			});
 		}
 
+		/// Sends the given status and closes the connection without reading the rest of the request.
+		void reject(const std::shared_ptr<Session>& session, StatusCode status_code) {
+			auto response = std::shared_ptr<Response>(new Response(session, this->config.timeout_content));
+			response->close_connection_after_response = true;
+			response->write(status_code, { {"Connection", "close"} });
+			response->send();
+		}
+
+		/// Lets on_request_body accept or reject the body of the request, rejects a Content-Length body that is not streamed and
+		/// does not fit in the streambuf, and then answers Expect: 100-continue. content_length is 0 for chunked bodies, whose
+		/// size is checked as they are read. Returns false if the request was rejected.
+		bool accept_body(const std::shared_ptr<Session>& session, unsigned long long content_length) {
+			session->body_stream = nullptr;
+			if (on_request_body) {
+				std::shared_ptr<BodyStream> body_stream;
+				StatusCode status_code;
+				try {
+					status_code = on_request_body(session->request, body_stream);
+				}
+				catch (const std::exception&) {
+					status_code = StatusCode::server_error_internal_server_error;
+				}
+				if (status_code != StatusCode::success_ok) {
+					reject(session, status_code);
+					return false;
+				}
+				session->body_stream = std::move(body_stream);
+			}
+			if (!session->body_stream && content_length > session->request->streambuf.max_size()) {
+				reject(session, StatusCode::client_error_payload_too_large);
+				if (this->on_error)
+					this->on_error(session->request, make_error_code::make_error_code(errc::message_size));
+				return false;
+			}
+
+			auto it = session->request->header.find("Expect");
+			if (it != session->request->header.end() && case_insensitive_equal(it->second, "100-continue")) {
+				// The body is read while this is being written, which is fine since the client waits for it before sending
+				auto continue_buffer = std::make_shared<std::string>("HTTP/1.1 100 Continue\r\n\r\n");
+				SocketWriter<socket_type>::async_write(*session->connection->socket, asio::buffer(*continue_buffer), [session, continue_buffer](const error_code& /*ec*/, std::size_t /*bytes_transferred*/) {
+					// Errors are reported by the pending read
+				});
+			}
+			return true;
+		}
+
+		/// Hands what has been read of the body to the body stream, if any, and calls next when the body stream is ready
+		/// for more. Without a body stream the body is kept in Request::content and next is called directly.
+		void forward_body(const std::shared_ptr<Session>& session, std::function<void()> next, std::size_t size = (std::numeric_limits<std::size_t>::max)()) {
+			auto& streambuf = session->request->streambuf;
+			if (!session->body_stream) {
+				next();
+				return;
+			}
+			size = std::min(size, streambuf.size());
+			if (size == 0 || !session->body_stream->on_data) {
+				streambuf.consume(size);
+				next();
+				return;
+			}
+			auto handler_runner = session->connection->handler_runner;
+			auto data = static_cast<const char*>(streambuf.data().data()); // Always one contiguous buffer for asio::streambuf
+			try {
+				session->body_stream->on_data(data, size, [handler_runner, session, size, next] {
+					auto lock = handler_runner->continue_lock();
+					if (!lock)
+						return;
+					session->request->streambuf.consume(size);
+					next();
+				});
+			}
+			catch (const std::exception&) {
+				if (this->on_error)
+					this->on_error(session->request, make_error_code::make_error_code(errc::operation_canceled));
+			}
+		}
+
+		/// Reads the remaining bytes of a Content-Length body into the body stream, one part at a time.
+		void read_body_stream(const std::shared_ptr<Session>& session, unsigned long long remaining) {
+			auto& streambuf = session->request->streambuf;
+			// Bytes past the body, e.g. of a pipelined request, are left in streambuf
+			if (remaining == 0) {
+				this->end_body(session);
+				return;
+			}
+			if (streambuf.size() > 0) {
+				auto size = static_cast<std::size_t>(std::min<unsigned long long>(streambuf.size(), remaining));
+				this->forward_body(session, [this, session, remaining, size] { this->read_body_stream(session, remaining - size); }, size);
+				return;
+			}
+
+			session->connection->set_timeout(config.timeout_content);
+			auto size = std::min<unsigned long long>(remaining, std::min(config.body_stream_chunk_size, streambuf.max_size()));
+			asio::async_read(*session->connection->socket, streambuf, asio::transfer_exactly(static_cast<std::size_t>(size)), [this, session, remaining](const error_code& ec, std::size_t /*bytes_transferred*/) {
+				auto lock = session->connection->handler_runner->continue_lock();
+				if (!lock)
+					return;
+
+				if (!ec)
+					this->read_body_stream(session, remaining);
+				else
+					this->body_error(session, ec);
+			});
+		}
+
+		void body_error(const std::shared_ptr<Session>& session, const error_code& ec) {
+			if (session->body_stream && session->body_stream->on_error)
+				session->body_stream->on_error(ec);
+			if (this->on_error)
+				this->on_error(session->request, ec);
+		}
+
+		void end_body(const std::shared_ptr<Session>& session) {
+			if (session->body_stream && session->body_stream->on_end)
+				session->body_stream->on_end();
+			this->find_resource(session);
+		}
+
 		void find_resource(const std::shared_ptr<Session>& session) {
 			// Upgrade connection
 			if (on_upgrade) {
@@ -745,12 +1211,56 @@ namespace SimpleWeb {
 				write(session, it->second);
 		}
 
+		/// Free list of Response objects, one per io thread so that no locking is needed.
+		static std::vector<std::unique_ptr<Response>>& response_free_list() noexcept {
+			thread_local std::vector<std::unique_ptr<Response>> free_list;
+			return free_list;
+		}
+
+		Response* acquire_response(const std::shared_ptr<Session>& session) {
+			auto& free_list = response_free_list();
+			if (!free_list.empty()) {
+				auto response = free_list.back().release();
+				free_list.pop_back();
+				response->reset(session, config.timeout_content);
+				return response;
+			}
+			return new Response(session, config.timeout_content);
+		}
+
+		/// Static since the last reference to a Response can be released after the server has been destroyed.
+		static void release_response(Response* response, std::size_t response_pool_size, std::size_t max_pooled_buffer_size) noexcept {
+			response->session = nullptr; // Do not keep the connection alive while pooled
+			auto& free_list = response_free_list();
+			if (free_list.size() < response_pool_size && (!response->streambuf || response->streambuf->capacity() <= max_pooled_buffer_size))
+				free_list.emplace_back(response);
+			else
+				delete response;
+		}
+
+		/// Returns a Session for the next request on the connection of the given session.
+		/// The Session and its Request are reused unless a handler still holds a reference to the Request.
+		std::shared_ptr<Session> next_session(const std::shared_ptr<Session>& session) {
+			if (session->request.use_count() == 1 && session->request->streambuf.capacity() <= config.max_pooled_buffer_size) {
+				session->request->reset();
+				session->body_stream = nullptr;
+				return session;
+			}
+			return std::make_shared<Session>(config.max_request_streambuf_size, session->connection);
+		}
+
 		void write(const std::shared_ptr<Session>& session,
 			std::function<void(std::shared_ptr<typename ServerBase<socket_type>::Response>, std::shared_ptr<typename ServerBase<socket_type>::Request>)>& resource_function) {
-			auto response = std::shared_ptr<Response>(new Response(session, config.timeout_content), [this](Response* response_ptr) {
-				auto response = std::shared_ptr<Response>(response_ptr);
+			auto response = std::shared_ptr<Response>(acquire_response(session), [this](Response* response_ptr) {
+				auto response_pool_size = this->config.response_pool_size;
+				auto max_pooled_buffer_size = this->config.max_pooled_buffer_size;
+				auto response = std::shared_ptr<Response>(response_ptr, [response_pool_size, max_pooled_buffer_size](Response* response_ptr) {
+					release_response(response_ptr, response_pool_size, max_pooled_buffer_size);
+				});
 				response->send_on_delete([this, response](const error_code& ec) {
 					response->session->connection->cancel_timeout();
+					if (this->on_response)
+						this->on_response(response->session->request, response->status, ec);
 					if (!ec) {
 						if (response->close_connection_after_response)
 							return;
@@ -760,14 +1270,12 @@ namespace SimpleWeb {
 							if (case_insensitive_equal(it->second, "close"))
 								return;
 							else if (case_insensitive_equal(it->second, "keep-alive")) {
-								auto new_session = std::make_shared<Session>(this->config.max_request_streambuf_size, response->session->connection);
-								this->read(new_session);
+								this->read(this->next_session(response->session));
 								return;
 							}
 						}
 						if (response->session->request->http_version >= "1.1") {
-							auto new_session = std::make_shared<Session>(this->config.max_request_streambuf_size, response->session->connection);
-							this->read(new_session);
+							this->read(this->next_session(response->session));
 							return;
 						}
 					}
@@ -814,6 +1322,9 @@ namespace SimpleWeb {
 				auto session = std::make_shared<Session>(config.max_request_streambuf_size, connection);
 
 				if (!ec) {
+					if (this->on_accept)
+						this->on_accept();
+
 					asio::ip::tcp::no_delay option(true);
 					error_code _ec;
 					session->connection->socket->set_option(option, _ec);
@@ -824,6 +1335,37 @@ namespace SimpleWeb {
 					this->on_error(session->request, ec);
 			});
 		}
+
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+		void accept_local() override {
+			auto connection = create_connection(*io_service);
+			auto local_socket = std::make_shared<LocalSocket::protocol_type::socket>(*io_service);
+
+			local_acceptor->async_accept(*local_socket, [this, connection, local_socket](const error_code& ec) {
+				auto lock = connection->handler_runner->continue_lock();
+				if (!lock)
+					return;
+
+				if (ec != error::operation_aborted)
+					this->accept_local();
+
+				auto session = std::make_shared<Session>(config.max_request_streambuf_size, connection);
+
+				error_code _ec = ec;
+				if (!_ec)
+					LocalSocket::adopt(*local_socket, connection->socket->lowest_layer(), _ec);
+
+				if (!_ec) {
+					if (this->on_accept)
+						this->on_accept();
+
+					this->read(session);
+				}
+				else if (this->on_error)
+					this->on_error(session->request, _ec);
+			});
+		}
+#endif
 	};
 } // namespace SimpleWeb
 
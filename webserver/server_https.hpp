@@ -2,6 +2,7 @@
 #define SIMPLE_WEB_SERVER_HTTPS_HPP
 
 #include "server_http.hpp"
+#include "../common/tls_session.hpp"
 
 #ifdef USE_STANDALONE_ASIO
 #include "../asio/ssl.hpp"
@@ -17,8 +18,6 @@ namespace SimpleWeb {
 
   template <>
   class Server<HTTPS> : public ServerBase<HTTPS> {
-    bool set_session_id_context = false;
-
   public:
     /**
      * Constructs a server object.
@@ -35,22 +34,23 @@ namespace SimpleWeb {
       if(verify_file.size() > 0) {
         context.load_verify_file(verify_file);
         context.set_verify_mode(asio::ssl::verify_peer | asio::ssl::verify_fail_if_no_peer_cert | asio::ssl::verify_client_once);
-        set_session_id_context = true;
       }
     }
 
   protected:
+    TlsSessionResumption session_resumption; // Declared before context, which refers to it
+    TlsRecordSizing record_sizing;
     asio::ssl::context context;
+    TlsHandshakePool handshake_pool;
 
     void after_bind() override {
-      if(set_session_id_context) {
-        // Creating session_id_context from address:port but reversed due to small SSL_MAX_SSL_SESSION_ID_LENGTH
-        auto session_id_context = std::to_string(acceptor->local_endpoint().port()) + ':';
-        session_id_context.append(config.address.rbegin(), config.address.rend());
-        SSL_CTX_set_session_id_context(context.native_handle(),
-                                       reinterpret_cast<const unsigned char *>(session_id_context.data()),
-                                       static_cast<unsigned int>(std::min<std::size_t>(session_id_context.size(), SSL_MAX_SSL_SESSION_ID_LENGTH)));
-      }
+      // Creating session_id_context from address:port but reversed due to small SSL_MAX_SSL_SESSION_ID_LENGTH
+      auto session_id_context = std::to_string(acceptor->local_endpoint().port()) + ':';
+      session_id_context.append(config.address.rbegin(), config.address.rend());
+      session_resumption.enable(context.native_handle(), session_id_context, config.tls_session_cache_size, config.tls_session_timeout,
+                                config.tls_session_tickets, config.tls_ticket_key_rotation);
+      record_sizing.enable(context.native_handle(), config.tls_initial_record_size, config.tls_record_ramp_bytes, config.tls_record_idle_reset);
+      handshake_pool.start(config.handshake_thread_pool_size);
     }
 
     void accept() override {
@@ -67,16 +67,23 @@ namespace SimpleWeb {
         auto session = std::make_shared<Session>(config.max_request_streambuf_size, connection);
 
         if(!ec) {
+          if(this->on_accept)
+            this->on_accept();
+
           asio::ip::tcp::no_delay option(true);
           error_code _ec;
           session->connection->socket->lowest_layer().set_option(option, _ec);
 
           session->connection->set_timeout(config.timeout_request);
-          session->connection->socket->async_handshake(asio::ssl::stream_base::server, [this, session](const error_code &ec) {
+          handshake_pool.async_handshake(*session->connection->socket, [this, session](const error_code &ec) {
             session->connection->cancel_timeout();
             auto lock = session->connection->handler_runner->continue_lock();
             if(!lock)
               return;
+            if(!ec && config.kernel_tls)
+              KernelTls::enable(*session->connection->socket);
+            if(this->on_handshake)
+              this->on_handshake(ec, !ec && SSL_session_reused(session->connection->socket->native_handle()) == 1);
             if(!ec)
               this->read(session);
             else if(this->on_error)
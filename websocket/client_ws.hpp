@@ -3,8 +3,13 @@
 
 #include  "../common/asio_compatibility.hpp"
 //#include  "../common/crypto.hpp"
+#include  "../common/dns_cache.hpp"
+#include  "../common/happy_eyeballs.hpp"
+#include  "../common/local_socket.hpp"
 #include  "../common/mutex.hpp"
 #include  "../common/utility.hpp"
+#include  "../common/websocket_frame.hpp"
+#include <algorithm>
 #include <array>
 #include <atomic>
 #include <iostream>
@@ -37,6 +42,12 @@ namespace SimpleWeb {
 				return std::string(asio::buffers_begin(streambuf.data()), asio::buffers_end(streambuf.data()));
 			}
 
+			/// The payload, in one contiguous buffer that lives as long as the message.
+			/// Bytes already read through the istream interface are not included.
+			const char* data() noexcept {
+				return static_cast<const char*>(streambuf.data().data());
+			}
+
 		private:
 			InMessage() noexcept : std::istream(&streambuf), length(0) {}
 			InMessage(unsigned char fin_rsv_opcode, std::size_t length) noexcept : std::istream(&streambuf), fin_rsv_opcode(fin_rsv_opcode), length(length) {}
@@ -77,6 +88,13 @@ namespace SimpleWeb {
 			Connection(std::shared_ptr<ScopeRunner> handler_runner_, long timeout_idle, Args &&...args) noexcept
 				: handler_runner(std::move(handler_runner_)), socket(new socket_type(std::forward<Args>(args)...)), timeout_idle(timeout_idle), closed(false) {}
 
+		public:
+			~Connection() noexcept {
+				ConnectionTeardown<socket_type>::before_destroy(*socket);
+			}
+
+		private:
+
 			std::shared_ptr<ScopeRunner> handler_runner;
 
 			std::unique_ptr<socket_type> socket; // Socket must be unique_ptr since asio::ssl::stream<asio::ip::tcp::socket> is not movable
@@ -90,14 +108,39 @@ namespace SimpleWeb {
 
 			std::atomic<bool> closed;
 
+			Mutex connect_mutex;
+			bool connect_canceled GUARDED_BY(connect_mutex) = false; // close() was called, so the socket must not be connected anymore
+			std::weak_ptr<HappyEyeballs> connect_race GUARDED_BY(connect_mutex);
+
 			asio::ip::tcp::endpoint endpoint; // The endpoint is read in SocketClient::upgrade and must be stored so that it can be read reliably in all handlers, including on_error
 
 			void close() noexcept {
+				std::shared_ptr<HappyEyeballs> race;
+				{
+					LockGuard lock(connect_mutex);
+					connect_canceled = true;
+					race = connect_race.lock();
+				}
+				if (race)
+					race->cancel();
+
 				error_code ec;
 				socket->lowest_layer().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
 				socket->lowest_layer().cancel(ec);
 			}
 
+			/// Lets close() cancel the race connecting the socket. Returns false if close() has already been called.
+			bool set_connect_race(const std::shared_ptr<HappyEyeballs>& race) noexcept {
+				LockGuard lock(connect_mutex);
+				connect_race = race;
+				return !connect_canceled;
+			}
+
+			bool is_connect_canceled() noexcept {
+				LockGuard lock(connect_mutex);
+				return connect_canceled;
+			}
+
 			void set_timeout(long seconds = -1) noexcept {
 				bool use_timeout_idle = false;
 				if (seconds == -1) {
@@ -199,33 +242,17 @@ namespace SimpleWeb {
 
 				std::size_t length = out_message->size();
 
-				std::size_t max_additional_bytes = 14; // ws protocol adds at most 14 bytes
-				auto out_header_and_message = std::make_shared<OutMessage>(length + max_additional_bytes);
+				auto out_header_and_message = std::make_shared<OutMessage>(length + WebSocketFrame::max_header_size);
 
-				out_header_and_message->put(static_cast<char>(fin_rsv_opcode));
-				// Masked (first length byte>=128)
-				if (length >= 126) {
-					std::size_t num_bytes;
-					if (length > 0xffff) {
-						num_bytes = 8;
-						out_header_and_message->put(static_cast<char>(127 + 128));
-					}
-					else {
-						num_bytes = 2;
-						out_header_and_message->put(static_cast<char>(126 + 128));
-					}
+				// Masked
+				unsigned char header[WebSocketFrame::max_header_size];
+				out_header_and_message->write(reinterpret_cast<const char*>(header), static_cast<std::streamsize>(WebSocketFrame::write_header(header, fin_rsv_opcode, length, mask.data())));
 
-					for (std::size_t c = num_bytes - 1; c != static_cast<std::size_t>(-1); c--)
-						out_header_and_message->put((static_cast<unsigned long long>(length) >> (8 * c)) % 256);
-				}
-				else
-					out_header_and_message->put(static_cast<char>(length + 128));
-
-				for (std::size_t c = 0; c < 4; c++)
-					out_header_and_message->put(static_cast<char>(mask[c]));
-
-				for (std::size_t c = 0; c < length; c++)
-					out_header_and_message->put(out_message->get() ^ mask[c % 4]);
+				auto source = out_message->streambuf.data();
+				auto destination = out_header_and_message->streambuf.prepare(length);
+				WebSocketFrame::apply_mask(static_cast<const char*>(source.data()), static_cast<char*>(destination.data()), length, mask);
+				out_header_and_message->streambuf.commit(length);
+				out_message->streambuf.consume(length);
 
 				LockGuard lock(send_queue_mutex);
 				send_queue.emplace_back(std::move(out_header_and_message), std::move(callback));
@@ -285,6 +312,20 @@ namespace SimpleWeb {
 			std::string proxy_server;
 			/// Set proxy authorization (username:password)
 			std::string proxy_auth;
+			/// Connect again when the connection is lost or could not be established, unless it was closed by this client or stop() was called.
+			/// The n-th attempt waits a random delay between half and all of reconnect_delay_min*2^n milliseconds, capped at reconnect_delay_max,
+			/// so that many clients losing the same server don't all come back at once.
+			bool reconnect = false;
+			long reconnect_delay_min = 500;
+			long reconnect_delay_max = 30000;
+			/// Seconds during which the resolved addresses of the server are reused, through the DnsCache shared by all clients.
+			/// Set to 0 to resolve on every connection.
+			long dns_cache_ttl = 60;
+			/// Milliseconds to wait for a connection attempt before also trying the next address, see HappyEyeballs.
+			/// Set to 0 to try the addresses one after the other.
+			long connection_attempt_delay = 250;
+			/// Seconds a connection made by prewarm() is kept for start(). An older one is closed and start() connects anew.
+			long prewarm_timeout = 30;
 		};
 		/// Set before calling start().
 		Config config;
@@ -295,6 +336,8 @@ namespace SimpleWeb {
 		std::function<void(std::shared_ptr<Connection>, const error_code&)> on_error;
 		std::function<void(std::shared_ptr<Connection>)> on_ping;
 		std::function<void(std::shared_ptr<Connection>)> on_pong;
+		/// Called when a reconnect is scheduled, with the attempt number starting at 1 and the delay in milliseconds. See Config::reconnect.
+		std::function<void(int, long)> on_reconnect;
 
 		/// Start the client.
 		/// If io_service is not set, an internal io_service is created instead.
@@ -311,6 +354,12 @@ namespace SimpleWeb {
 				if (io_service->stopped())
 					restart(*io_service);
 
+				{
+					LockGuard lock(connection_mutex);
+					stopped = false;
+					reconnect_attempt = 0;
+				}
+
 				connect();
 
 				if (callback)
@@ -321,14 +370,59 @@ namespace SimpleWeb {
 				io_service->run();
 		}
 
+		/// Connects to the server ahead of start(), including the TLS handshake of a secure client, so that start() only has
+		/// the WebSocket upgrade left to do. Does nothing unless io_service is set, since an internal one only runs from start().
+		/// If the connection fails, start() connects anew.
+		void prewarm() {
+			LockGuard lock(connection_mutex);
+			if (!io_service || prewarmed.connection)
+				return;
+			auto connection = prewarmed.connection = create_connection();
+			prewarmed.ready = false;
+			prewarmed.wanted = false;
+			lock.unlock();
+
+			connect_transport(connection, [this, connection](const error_code& ec) {
+				LockGuard lock(connection_mutex);
+				if (prewarmed.connection != connection)
+					return;
+				if (!prewarmed.wanted) {
+					if (ec)
+						prewarmed.connection = nullptr;
+					else {
+						prewarmed.ready = true;
+						prewarmed.time = std::chrono::steady_clock::now();
+					}
+					return;
+				}
+
+				// start() was called while connecting, and waits for this connection
+				prewarmed.connection = nullptr;
+				lock.unlock();
+				if (!ec)
+					this->upgrade(connection);
+				else
+					this->connection_error(connection, ec);
+			});
+		}
+
 		/// Stop client, and close current connection
 		void stop() noexcept {
 			std::lock_guard<std::mutex> lock(start_stop_mutex);
 
 			{
 				LockGuard _lock(connection_mutex);
+				stopped = true;
+				if (reconnect_timer) {
+					error_code ec;
+					reconnect_timer->cancel(ec);
+				}
 				if (connection)
 					connection->close();
+				if (prewarmed.connection) {
+					prewarmed.connection->close();
+					prewarmed.connection = nullptr;
+				}
 			}
 
 			if (internal_io_service)
@@ -352,13 +446,36 @@ namespace SimpleWeb {
 		unsigned short port;
 		unsigned short default_port;
 		std::string path;
+		std::string unix_socket_path; // Set by a unix: URL, see LocalSocket::parse_url
 
 		Mutex connection_mutex;
 		std::shared_ptr<Connection> connection GUARDED_BY(connection_mutex);
 
+		bool stopped GUARDED_BY(connection_mutex) = false;
+		int reconnect_attempt GUARDED_BY(connection_mutex) = 0;
+		std::unique_ptr<asio::steady_timer> reconnect_timer GUARDED_BY(connection_mutex);
+		std::minstd_rand reconnect_random{std::random_device{}()};
+
+		struct Prewarmed {
+			std::shared_ptr<Connection> connection;
+			bool ready = false; // Connected, and waiting for start()
+			bool wanted = false; // start() was called while connecting
+			std::chrono::steady_clock::time_point time;
+		};
+		Prewarmed prewarmed GUARDED_BY(connection_mutex);
+
+		/// Endpoint of the last connection, tried first on the next one. Only used from handlers, which don't run concurrently for one client.
+		asio::ip::tcp::endpoint last_endpoint;
+
 		std::shared_ptr<ScopeRunner> handler_runner;
 
 		SocketClientBase(const std::string& host_port_path, unsigned short default_port) noexcept : default_port(default_port), handler_runner(new ScopeRunner()) {
+			if (LocalSocket::parse_url(host_port_path, unix_socket_path, path)) {
+				host = "localhost";
+				port = default_port;
+				return;
+			}
+
 			auto host_port_end = host_port_path.find('/');
 			auto host_port = parse_host_port(host_port_path.substr(0, host_port_end), default_port);
 			host = std::move(host_port.first);
@@ -389,11 +506,165 @@ namespace SimpleWeb {
 			return parsed_host_port;
 		}
 
-		virtual void connect() = 0;
+		virtual std::shared_ptr<Connection> create_connection() = 0;
+
+		/// Connects the socket of connection, and completes the TLS handshake of a secure client.
+		/// handler is called with the continue lock of the handler runner held.
+		virtual void connect_transport(const std::shared_ptr<Connection>& connection, std::function<void(const error_code&)> handler) = 0;
+
+		/// Makes the connection of the client, or takes over the one made by prewarm().
+		void connect() {
+			LockGuard lock(connection_mutex);
+			if (prewarmed.connection) {
+				auto connection = prewarmed.connection;
+				if (!prewarmed.ready) {
+					this->connection = connection;
+					prewarmed.wanted = true;
+					return;
+				}
+
+				prewarmed.connection = nullptr;
+				if (std::chrono::steady_clock::now() - prewarmed.time < std::chrono::seconds(config.prewarm_timeout)) {
+					this->connection = connection;
+					lock.unlock();
+					upgrade(connection);
+					return;
+				}
+				connection->close();
+			}
+
+			auto connection = this->connection = create_connection();
+			lock.unlock();
+
+			connect_transport(connection, [this, connection](const error_code& ec) {
+				if (!ec)
+					this->upgrade(connection);
+				else
+					this->connection_error(connection, ec);
+			});
+		}
+
+		/// Connects the socket of connection to the server, or to the proxy server if one is set. The addresses are raced as in
+		/// RFC 8305 Happy Eyeballs, starting with the endpoint of the last connection if it is still among them.
+		/// If none can be connected to, they are dropped from the DnsCache so that the next attempt resolves the host again.
+		/// With a unix: URL, the socket path is connected to instead, and the proxy server is not used.
+		void connect_socket(const std::shared_ptr<Connection>& connection, std::function<void(const error_code&)> handler) {
+			if (!unix_socket_path.empty()) {
+#ifdef SIMPLE_WEB_LOCAL_SOCKETS
+				auto local_socket = std::make_shared<LocalSocket::protocol_type::socket>(*io_service);
+				local_socket->async_connect(LocalSocket::protocol_type::endpoint(unix_socket_path), [connection, local_socket, handler](const error_code& ec) {
+					auto lock = connection->handler_runner->continue_lock();
+					if (!lock)
+						return;
+					error_code _ec = ec;
+					if (!_ec && connection->is_connect_canceled())
+						_ec = error::operation_aborted;
+					if (!_ec)
+						LocalSocket::adopt(*local_socket, connection->socket->lowest_layer(), _ec);
+					handler(_ec);
+				});
+#else
+				post(*io_service, [connection, handler] {
+					auto lock = connection->handler_runner->continue_lock();
+					if (!lock)
+						return;
+					handler(make_error_code::make_error_code(errc::address_family_not_supported));
+				});
+#endif
+				return;
+			}
+
+			std::pair<std::string, std::string> host_port;
+			if (config.proxy_server.empty())
+				host_port = { host, std::to_string(port) };
+			else {
+				auto proxy_host_port = parse_host_port(config.proxy_server, 8080);
+				host_port = { proxy_host_port.first, std::to_string(proxy_host_port.second) };
+			}
+
+			DnsCache::shared().async_resolve(io_service, host_port, config.dns_cache_ttl, config.timeout_request, [this, connection, host_port, handler](const error_code& ec, const DnsCache::endpoints_type& endpoints) {
+				auto lock = connection->handler_runner->continue_lock();
+				if (!lock)
+					return;
+				if (ec) {
+					handler(ec);
+					return;
+				}
+
+				auto ordered = HappyEyeballs::interleave(endpoints);
+				auto last = std::find(ordered.begin(), ordered.end(), this->last_endpoint);
+				if (last != ordered.end())
+					std::rotate(ordered.begin(), last, last + 1);
+
+				auto race = HappyEyeballs::async_connect(*this->io_service, connection->socket->lowest_layer(), std::move(ordered), this->config.connection_attempt_delay, this->config.timeout_request,
+					[this, connection, host_port, handler](const error_code& ec, const asio::ip::tcp::endpoint& endpoint) {
+						auto lock = connection->handler_runner->continue_lock();
+						if (!lock)
+							return;
+						if (!ec)
+							this->last_endpoint = endpoint;
+						else if (ec != error::operation_aborted) {
+							this->last_endpoint = asio::ip::tcp::endpoint();
+							DnsCache::shared().invalidate(host_port);
+						}
+						handler(ec);
+					});
+				if (race && !connection->set_connect_race(race))
+					race->cancel();
+			});
+		}
+
+		/// Schedules a new connection after the current one was lost, see Config::reconnect
+		void reconnect_later(const std::shared_ptr<Connection>& connection) {
+			if (!config.reconnect)
+				return;
+
+			long delay;
+			int attempt;
+			{
+				LockGuard lock(connection_mutex);
+				// Only once per connection, and not once stop() has been called
+				if (stopped || this->connection != connection)
+					return;
+				this->connection = nullptr;
+
+				attempt = ++reconnect_attempt;
+				long cap = config.reconnect_delay_max;
+				if (attempt < 30)
+					cap = (std::min)(cap, config.reconnect_delay_min << (attempt - 1));
+				cap = (std::max)(cap, 1L);
+				delay = std::uniform_int_distribution<long>(cap / 2, cap)(reconnect_random);
+
+				reconnect_timer = std::unique_ptr<asio::steady_timer>(new asio::steady_timer(*io_service, std::chrono::milliseconds(delay)));
+				reconnect_timer->async_wait([this](const error_code& ec) {
+					if (ec)
+						return;
+					auto lock = this->handler_runner->continue_lock();
+					if (!lock)
+						return;
+					{
+						LockGuard _lock(this->connection_mutex);
+						if (this->stopped)
+							return;
+					}
+					this->connect();
+				});
+			}
+
+			if (on_reconnect)
+				on_reconnect(attempt, delay);
+		}
 
 		void upgrade(const std::shared_ptr<Connection>& connection) {
+			{
+				// The connection may have been made after stop() or close() was called, since the handler runner stays alive
+				LockGuard lock(connection_mutex);
+				if (stopped || connection->is_connect_canceled())
+					return;
+			}
+
 			auto corrected_path = path;
-			if (!config.proxy_server.empty() && std::is_same<socket_type, asio::ip::tcp::socket>::value)
+			if (!config.proxy_server.empty() && unix_socket_path.empty() && std::is_same<socket_type, asio::ip::tcp::socket>::value)
 				corrected_path = "http://" + host + ':' + std::to_string(port) + corrected_path;
 
 			auto streambuf = std::make_shared<asio::streambuf>();
@@ -423,7 +694,7 @@ namespace SimpleWeb {
 			ostream << "\r\n";
 
 			try {
-				connection->endpoint = connection->socket->lowest_layer().remote_endpoint();
+				connection->endpoint = LocalSocket::remote_endpoint(connection->socket->lowest_layer());
 			}
 			catch (...) {
 			}
@@ -461,16 +732,16 @@ namespace SimpleWeb {
 							auto header_it = connection->header.find("Sec-WebSocket-Accept");
 							static auto ws_magic_string = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
-							std::string b64 = WSCrypto::base64_decode(header_it->second);
-
 							std::string inSha = *nonce_base64 + ws_magic_string;
 							unsigned char hash[20];
 							WSCrypto::calcSha1(inSha.c_str(), (int)inSha.size(), hash);
 
-							std::string hexString((const char*)hash);
-							hexString.resize(20);
-
-							if (header_it != connection->header.end() && strcmp(b64.c_str(), hexString.c_str()) == 0) {
+							// The digest may hold zero bytes, so all of it is compared
+							if (header_it != connection->header.end() && WSCrypto::base64_decode(header_it->second) == std::string((const char*)hash, sizeof(hash))) {
+								{
+									LockGuard lock(this->connection_mutex);
+									this->reconnect_attempt = 0;
+								}
 								this->connection_open(connection);
 								read_message(connection, num_additional_bytes);
 							}
@@ -614,8 +885,11 @@ namespace SimpleWeb {
 						}
 
 						auto reason = connection->in_message->string();
+						bool closed_by_client = connection->closed; // The server is answering our close frame
 						connection->send_close(status, reason);
 						this->connection_close(connection, status, reason);
+						if (!closed_by_client)
+							this->reconnect_later(connection);
 					}
 					// If ping
 					else if ((connection->in_message->fin_rsv_opcode & 0x0f) == 9) {
@@ -697,9 +971,11 @@ namespace SimpleWeb {
 				on_close(connection, status, reason);
 		}
 
-		void connection_error(const std::shared_ptr<Connection>& connection, const error_code& ec) const {
+		void connection_error(const std::shared_ptr<Connection>& connection, const error_code& ec) {
 			if (on_error)
 				on_error(connection, ec);
+			if (!connection->closed) // Not after a close frame sent by this client, e.g. on idle timeout
+				reconnect_later(connection);
 		}
 	};
 
@@ -714,45 +990,18 @@ namespace SimpleWeb {
 		SocketClient(const std::string& server_port_path) noexcept : SocketClientBase<WS>::SocketClientBase(server_port_path, 80) {};
 
 	protected:
-		void connect() override {
-			LockGuard lock(connection_mutex);
-			auto connection = this->connection = std::shared_ptr<Connection>(new Connection(handler_runner, config.timeout_idle, *io_service));
-			lock.unlock();
-
-			std::pair<std::string, std::string> host_port;
-			if (config.proxy_server.empty())
-				host_port = { host, std::to_string(port) };
-			else {
-				auto proxy_host_port = parse_host_port(config.proxy_server, 8080);
-				host_port = { proxy_host_port.first, std::to_string(proxy_host_port.second) };
-			}
+		std::shared_ptr<Connection> create_connection() override {
+			return std::shared_ptr<Connection>(new Connection(handler_runner, config.timeout_idle, *io_service));
+		}
 
-			auto resolver = std::make_shared<asio::ip::tcp::resolver>(*io_service);
-			connection->set_timeout(config.timeout_request);
-			async_resolve(*resolver, host_port, [this, connection, resolver](const error_code& ec, resolver_results results) {
-				connection->cancel_timeout();
-				auto lock = connection->handler_runner->continue_lock();
-				if (!lock)
-					return;
+		void connect_transport(const std::shared_ptr<Connection>& connection, std::function<void(const error_code&)> handler) override {
+			connect_socket(connection, [connection, handler](const error_code& ec) {
 				if (!ec) {
-					connection->set_timeout(this->config.timeout_request);
-					asio::async_connect(*connection->socket, results, [this, connection, resolver](const error_code& ec, async_connect_endpoint /*endpoint*/) {
-						connection->cancel_timeout();
-						auto lock = connection->handler_runner->continue_lock();
-						if (!lock)
-							return;
-						if (!ec) {
-							asio::ip::tcp::no_delay option(true);
-							connection->socket->set_option(option);
-
-							this->upgrade(connection);
-						}
-						else
-							this->connection_error(connection, ec);
-					});
+					asio::ip::tcp::no_delay option(true);
+					error_code ec;
+					connection->socket->set_option(option, ec);
 				}
-				else
-					this->connection_error(connection, ec);
+				handler(ec);
 			});
 		}
 	};
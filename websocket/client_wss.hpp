@@ -2,6 +2,7 @@
 #define SIMPLE_WEB_CLIENT_WSS_HPP
 
 #include "client_ws.hpp"
+#include "../common/tls_session.hpp"
 
 #ifdef USE_STANDALONE_ASIO
 #include "../asio/ssl.hpp"
@@ -27,127 +28,124 @@ namespace SimpleWeb {
     SocketClient(const std::string &server_port_path, bool verify_certificate = true,
                  const std::string &certification_file = std::string(), const std::string &private_key_file = std::string(),
                  const std::string &verify_file = std::string())
-        : SocketClientBase<WSS>::SocketClientBase(server_port_path, 443), context(asio::ssl::context::tlsv12) {
+        : SocketClient(server_port_path, make_context(verify_certificate, certification_file, private_key_file, verify_file)) {}
+
+    /**
+     * Constructs a client object on a context made by make_context(), which can be shared by many clients. Their
+     * connections then resume the TLS sessions of one another, and the certificates are only loaded once.
+     *
+     * @param server_port_path Server resource given by host[:port][/path]
+     * @param context          Context of the connections
+     */
+    SocketClient(const std::string &server_port_path, std::shared_ptr<asio::ssl::context> context)
+        : SocketClientBase<WSS>::SocketClientBase(server_port_path, 443), context(std::move(context)) {}
+
+    /// Makes a context for clients, with the parameters of the first constructor. The hostname is verified for each
+    /// connection, so the context does not depend on the server.
+    static std::shared_ptr<asio::ssl::context> make_context(bool verify_certificate = true,
+                                                            const std::string &certification_file = std::string(), const std::string &private_key_file = std::string(),
+                                                            const std::string &verify_file = std::string()) {
+      auto context = std::make_shared<asio::ssl::context>(asio::ssl::context::tlsv12);
       if(certification_file.size() > 0 && private_key_file.size() > 0) {
-        context.use_certificate_chain_file(certification_file);
-        context.use_private_key_file(private_key_file, asio::ssl::context::pem);
+        context->use_certificate_chain_file(certification_file);
+        context->use_private_key_file(private_key_file, asio::ssl::context::pem);
       }
 
-      if(verify_certificate)
-        context.set_verify_callback(asio::ssl::rfc2818_verification(host));
-
       if(verify_file.size() > 0)
-        context.load_verify_file(verify_file);
+        context->load_verify_file(verify_file);
       else
-        context.set_default_verify_paths();
+        context->set_default_verify_paths();
 
       if(verify_certificate)
-        context.set_verify_mode(asio::ssl::verify_peer);
+        context->set_verify_mode(asio::ssl::verify_peer);
       else
-        context.set_verify_mode(asio::ssl::verify_none);
-    };
+        context->set_verify_mode(asio::ssl::verify_none);
+
+      TlsClientSessionCache::enable(context->native_handle());
+      return context;
+    }
 
   protected:
-    asio::ssl::context context;
-
-    void connect() override {
-      LockGuard connection_lock(connection_mutex);
-      auto connection = this->connection = std::shared_ptr<Connection>(new Connection(handler_runner, config.timeout_idle, *io_service, context));
-      connection_lock.unlock();
-
-      std::pair<std::string, std::string> host_port;
-      if(config.proxy_server.empty())
-        host_port = {host, std::to_string(port)};
-      else {
-        auto proxy_host_port = parse_host_port(config.proxy_server, 8080);
-        host_port = {proxy_host_port.first, std::to_string(proxy_host_port.second)};
-      }
+    std::shared_ptr<asio::ssl::context> context;
 
-      auto resolver = std::make_shared<asio::ip::tcp::resolver>(*io_service);
-      connection->set_timeout(config.timeout_request);
-      async_resolve(*resolver, host_port, [this, connection, resolver](const error_code &ec, resolver_results results) {
-        connection->cancel_timeout();
-        auto lock = connection->handler_runner->continue_lock();
-        if(!lock)
-          return;
+    std::shared_ptr<Connection> create_connection() override {
+      return std::shared_ptr<Connection>(new Connection(handler_runner, config.timeout_idle, *io_service, *context));
+    }
+
+    void connect_transport(const std::shared_ptr<Connection> &connection, std::function<void(const error_code &)> handler) override {
+      connect_socket(connection, [this, connection, handler](const error_code &ec) {
         if(!ec) {
-          connection->set_timeout(this->config.timeout_request);
-          asio::async_connect(connection->socket->lowest_layer(), results, [this, connection, resolver](const error_code &ec, async_connect_endpoint /*endpoint*/) {
-            connection->cancel_timeout();
-            auto lock = connection->handler_runner->continue_lock();
-            if(!lock)
-              return;
-            if(!ec) {
-              asio::ip::tcp::no_delay option(true);
-              error_code ec;
-              connection->socket->lowest_layer().set_option(option, ec);
-
-              if(!this->config.proxy_server.empty()) {
-                auto streambuf = std::make_shared<asio::streambuf>();
-                std::ostream ostream(streambuf.get());
-                auto host_port = this->host + ':' + std::to_string(this->port);
-                ostream << "CONNECT " + host_port + " HTTP/1.1\r\n"
-                        << "Host: " << host_port << "\r\n";
-                if(!this->config.proxy_auth.empty())
-                  ostream << "Proxy-Authorization: Basic " << Crypto::Base64::encode(this->config.proxy_auth) << "\r\n";
-                ostream << "\r\n";
+          asio::ip::tcp::no_delay option(true);
+          error_code ec;
+          connection->socket->lowest_layer().set_option(option, ec);
+
+          if(!this->config.proxy_server.empty() && this->unix_socket_path.empty()) {
+            auto streambuf = std::make_shared<asio::streambuf>();
+            std::ostream ostream(streambuf.get());
+            auto host_port = this->host + ':' + std::to_string(this->port);
+            ostream << "CONNECT " + host_port + " HTTP/1.1\r\n"
+                    << "Host: " << host_port << "\r\n";
+            if(!this->config.proxy_auth.empty())
+              ostream << "Proxy-Authorization: Basic " << Crypto::Base64::encode(this->config.proxy_auth) << "\r\n";
+            ostream << "\r\n";
+            connection->set_timeout(this->config.timeout_request);
+            asio::async_write(connection->socket->next_layer(), *streambuf, [this, connection, streambuf, handler](const error_code &ec, std::size_t /*bytes_transferred*/) {
+              connection->cancel_timeout();
+              auto lock = connection->handler_runner->continue_lock();
+              if(!lock)
+                return;
+              if(!ec) {
                 connection->set_timeout(this->config.timeout_request);
-                asio::async_write(connection->socket->next_layer(), *streambuf, [this, connection, streambuf](const error_code &ec, std::size_t /*bytes_transferred*/) {
+                connection->in_message = std::shared_ptr<InMessage>(new InMessage());
+                asio::async_read_until(connection->socket->next_layer(), connection->in_message->streambuf, "\r\n\r\n", [this, connection, handler](const error_code &ec, std::size_t /*bytes_transferred*/) {
                   connection->cancel_timeout();
                   auto lock = connection->handler_runner->continue_lock();
                   if(!lock)
                     return;
                   if(!ec) {
-                    connection->set_timeout(this->config.timeout_request);
-                    connection->in_message = std::shared_ptr<InMessage>(new InMessage());
-                    asio::async_read_until(connection->socket->next_layer(), connection->in_message->streambuf, "\r\n\r\n", [this, connection](const error_code &ec, std::size_t /*bytes_transferred*/) {
-                      connection->cancel_timeout();
-                      auto lock = connection->handler_runner->continue_lock();
-                      if(!lock)
-                        return;
-                      if(!ec) {
-                        if(!ResponseMessage::parse(*connection->in_message, connection->http_version, connection->status_code, connection->header))
-                          this->connection_error(connection, make_error_code::make_error_code(errc::protocol_error));
-                        else {
-                          if(connection->status_code.compare(0, 3, "200") != 0)
-                            this->connection_error(connection, make_error_code::make_error_code(errc::permission_denied));
-                          else
-                            this->handshake(connection);
-                        }
-                      }
+                    if(!ResponseMessage::parse(*connection->in_message, connection->http_version, connection->status_code, connection->header))
+                      handler(make_error_code::make_error_code(errc::protocol_error));
+                    else {
+                      if(connection->status_code.compare(0, 3, "200") != 0)
+                        handler(make_error_code::make_error_code(errc::permission_denied));
                       else
-                        this->connection_error(connection, ec);
-                    });
+                        this->handshake(connection, handler);
+                    }
                   }
                   else
-                    this->connection_error(connection, ec);
+                    handler(ec);
                 });
               }
               else
-                this->handshake(connection);
-            }
-            else
-              this->connection_error(connection, ec);
-          });
+                handler(ec);
+            });
+          }
+          else
+            this->handshake(connection, handler);
         }
         else
-          this->connection_error(connection, ec);
+          handler(ec);
       });
     }
 
-    void handshake(const std::shared_ptr<Connection> &connection) {
-      SSL_set_tlsext_host_name(connection->socket->native_handle(), this->host.c_str());
+    void handshake(const std::shared_ptr<Connection> &connection, const std::function<void(const error_code &)> &handler) {
+      auto ssl = connection->socket->native_handle();
+      SSL_set_tlsext_host_name(ssl, this->host.c_str());
+      if(SSL_get_verify_mode(ssl) & SSL_VERIFY_PEER) {
+        error_code ec;
+        connection->socket->set_verify_callback(asio::ssl::rfc2818_verification(this->host), ec);
+      }
+      TlsClientSessionCache::prepare(ssl, this->host + ':' + std::to_string(this->port));
 
       connection->set_timeout(this->config.timeout_request);
-      connection->socket->async_handshake(asio::ssl::stream_base::client, [this, connection](const error_code &ec) {
+      connection->socket->async_handshake(asio::ssl::stream_base::client, [connection, handler](const error_code &ec) {
         connection->cancel_timeout();
         auto lock = connection->handler_runner->continue_lock();
         if(!lock)
           return;
-        if(!ec)
-          upgrade(connection);
-        else
-          this->connection_error(connection, ec);
+        if(ec)
+          TlsClientSessionCache::erase(connection->socket->native_handle());
+        handler(ec);
       });
     }
   };
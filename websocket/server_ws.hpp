@@ -2,9 +2,12 @@
 #define SIMPLE_WEB_SERVER_WS_HPP
 
 #include "../common/asio_compatibility.hpp"
+#include "../common/local_socket.hpp"
 //#include "../common/crypto.hpp"
 #include "../common/mutex.hpp"
+#include "../common/trace.hpp"
 #include "../common/utility.hpp"
+#include "../common/websocket_frame.hpp"
 #include <array>
 #include <atomic>
 #include <iostream>
@@ -50,6 +53,12 @@ namespace SimpleWeb {
         return std::string(asio::buffers_begin(streambuf.data()), asio::buffers_end(streambuf.data()));
       }
 
+      /// The unmasked payload, in one contiguous buffer that lives as long as the message.
+      /// Bytes already read through the istream interface are not included.
+      const char *data() noexcept {
+        return static_cast<const char *>(streambuf.data().data());
+      }
+
     private:
       InMessage() noexcept : std::istream(&streambuf), length(0) {}
       InMessage(unsigned char fin_rsv_opcode, std::size_t length) noexcept : std::istream(&streambuf), fin_rsv_opcode(fin_rsv_opcode), length(length) {}
@@ -83,6 +92,11 @@ namespace SimpleWeb {
     public:
       Connection(std::unique_ptr<socket_type> &&socket_) noexcept : socket(std::move(socket_)), timeout_idle(0), closed(false) {}
 
+      ~Connection() noexcept {
+        if(socket)
+          ConnectionTeardown<socket_type>::before_destroy(*socket);
+      }
+
       std::string method, path, query_string, http_version;
 
       CaseInsensitiveMultimap header;
@@ -99,7 +113,8 @@ namespace SimpleWeb {
 
       std::unique_ptr<socket_type> socket; // Socket must be unique_ptr since asio::ssl::stream<asio::ip::tcp::socket> is not movable
 
-      asio::streambuf streambuf;
+      /// Read buffer. Freed while waiting for the next frame when Config::low_footprint is set.
+      std::unique_ptr<asio::streambuf> streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
       std::shared_ptr<InMessage> fragmented_in_message;
 
       long timeout_idle;
@@ -157,6 +172,7 @@ namespace SimpleWeb {
         std::shared_ptr<OutMessage> out_header;
         std::shared_ptr<OutMessage> out_message;
         std::function<void(const error_code)> callback;
+        SIMPLEWEB_TRACE(unsigned char trace_fin_rsv_opcode = 0; std::int64_t trace_enqueue_time = 0;)
       };
 
       Mutex send_queue_mutex;
@@ -167,7 +183,7 @@ namespace SimpleWeb {
         std::array<asio::const_buffer, 2> buffers{send_queue.begin()->out_header->streambuf.data(), send_queue.begin()->out_message->streambuf.data()};
         auto self = this->shared_from_this();
         set_timeout();
-        asio::async_write(*socket, buffers, [self](const error_code &ec, std::size_t /*bytes_transferred*/) {
+        SocketWriter<socket_type>::async_write(*socket, buffers, [self](const error_code &ec, std::size_t /*bytes_transferred*/) {
           self->set_timeout(); // Set timeout for next send
           auto lock = self->handler_runner->continue_lock();
           if(!lock)
@@ -176,6 +192,7 @@ namespace SimpleWeb {
             LockGuard _lock(self->send_queue_mutex);
             if(!ec) {
               auto it = self->send_queue.begin();
+              SIMPLEWEB_TRACE(trace::ring().push_outbound(self.get(), it->trace_fin_rsv_opcode, it->out_message->size(), it->trace_enqueue_time, trace::now());)
               auto callback = std::move(it->callback);
               self->send_queue.erase(it);
               if(self->send_queue.size() > 0)
@@ -203,6 +220,12 @@ namespace SimpleWeb {
       }
 
     public:
+      /// Number of messages waiting to be sent, including the one being sent.
+      std::size_t send_queue_size() noexcept {
+        LockGuard lock(send_queue_mutex);
+        return send_queue.size();
+      }
+
       /// fin_rsv_opcode: 129=one fragment, text, 130=one fragment, binary, 136=close connection.
       /// See http://tools.ietf.org/html/rfc6455#section-5.2 for more information.
       void send(std::shared_ptr<OutMessage> out_message, std::function<void(const error_code &)> callback = nullptr, unsigned char fin_rsv_opcode = 129) {
@@ -210,27 +233,13 @@ namespace SimpleWeb {
 
         auto out_header = std::make_shared<OutMessage>(10); // Header is at most 10 bytes
 
-        out_header->put(static_cast<char>(fin_rsv_opcode));
-        // Unmasked (first length byte<128)
-        if(length >= 126) {
-          std::size_t num_bytes;
-          if(length > 0xffff) {
-            num_bytes = 8;
-            out_header->put(127);
-          }
-          else {
-            num_bytes = 2;
-            out_header->put(126);
-          }
-
-          for(std::size_t c = num_bytes - 1; c != static_cast<std::size_t>(-1); c--)
-            out_header->put((static_cast<unsigned long long>(length) >> (8 * c)) % 256);
-        }
-        else
-          out_header->put(static_cast<char>(length));
+        // Unmasked
+        unsigned char header[WebSocketFrame::max_header_size];
+        out_header->write(reinterpret_cast<const char *>(header), static_cast<std::streamsize>(WebSocketFrame::write_header(header, fin_rsv_opcode, length)));
 
         LockGuard lock(send_queue_mutex);
         send_queue.emplace_back(std::move(out_header), std::move(out_message), std::move(callback));
+        SIMPLEWEB_TRACE(send_queue.back().trace_fin_rsv_opcode = fin_rsv_opcode; send_queue.back().trace_enqueue_time = trace::now();)
         if(send_queue.size() == 1)
           send_from_queue();
       }
@@ -347,6 +356,32 @@ namespace SimpleWeb {
       bool reuse_address = true;
       /// Make use of RFC 7413 or TCP Fast Open (TFO)
       bool fast_open = false;
+      /// Reduce the memory held by idle connections, for servers with many mostly idle clients.
+      /// The handshake header, path_match, method, query_string and http_version of a connection are cleared after on_open,
+      /// and its read buffer is freed between frames. With WSS, OpenSSL also releases its buffers while idle.
+      bool low_footprint = false;
+      /// WSS only: number of TLS sessions kept for resumption by session id. Set to 0 to disable the cache.
+      std::size_t tls_session_cache_size = 20 * 1024;
+      /// WSS only: seconds during which a TLS session can be resumed, from the cache or a ticket. Defaults to 2 hours.
+      long tls_session_timeout = 7200;
+      /// WSS only: hand out stateless session tickets, which resume without any state kept on the server.
+      bool tls_session_tickets = true;
+      /// WSS only: seconds after which a new session ticket key is used. Defaults to 1 hour.
+      long tls_ticket_key_rotation = 3600;
+      /// WSS only: number of threads running TLS handshakes, apart from the threads serving established connections.
+      /// Defaults to 0, which runs the handshakes on the serving threads.
+      std::size_t handshake_thread_pool_size = 0;
+      /// WSS only: on Linux, have the kernel encrypt what is sent once the handshake is done. Needs the tls kernel
+      /// module and an AES-GCM cipher, otherwise connections silently stay with OpenSSL. Defaults to false.
+      bool kernel_tls = false;
+      /// WSS only: size of the TLS records written at the start of a connection and after it has been idle, so that the
+      /// client can decrypt the first bytes of a message early, e.g. 1400 to fit in a TCP segment. Records grow to 16 kB once
+      /// tls_record_ramp_bytes have been sent. Defaults to 0, which always writes full records.
+      std::size_t tls_initial_record_size = 0;
+      /// WSS only: bytes written with small records before switching to full ones. Defaults to 1 MB.
+      std::size_t tls_record_ramp_bytes = 1024 * 1024;
+      /// WSS only: milliseconds without writes after which a connection starts over with small records. Defaults to 1 second.
+      long tls_record_idle_reset = 1000;
     };
     /// Set before calling start().
     Config config;
@@ -474,7 +509,11 @@ namespace SimpleWeb {
       }
     }
 
-    virtual ~SocketServerBase() noexcept {}
+    /// Waits for running handlers and cancels the pending ones, since a shared io_service may outlive the server
+    virtual ~SocketServerBase() noexcept {
+      handler_runner->stop();
+      stop();
+    }
 
     std::unordered_set<std::shared_ptr<Connection>> get_connections() noexcept {
       std::unordered_set<std::shared_ptr<Connection>> all_connections;
@@ -525,16 +564,18 @@ namespace SimpleWeb {
 
     virtual void after_bind() {}
     virtual void accept() = 0;
+    /// Called once a low_footprint connection is open, to release the buffers specific to the socket type while idle.
+    virtual void release_idle_buffers(const std::shared_ptr<Connection> & /*connection*/) const {}
 
     void read_handshake(const std::shared_ptr<Connection> &connection) {
       connection->set_timeout(config.timeout_request);
-      asio::async_read_until(*connection->socket, connection->streambuf, "\r\n\r\n", [this, connection](const error_code &ec, std::size_t /*bytes_transferred*/) {
+      asio::async_read_until(*connection->socket, *connection->streambuf, "\r\n\r\n", [this, connection](const error_code &ec, std::size_t /*bytes_transferred*/) {
         connection->cancel_timeout();
         auto lock = connection->handler_runner->continue_lock();
         if(!lock)
           return;
         if(!ec) {
-          std::istream istream(&connection->streambuf);
+          std::istream istream(connection->streambuf.get());
           if(RequestMessage::parse(istream, connection->method, connection->path, connection->query_string, connection->http_version, connection->header))
             write_handshake(connection);
         }
@@ -563,15 +604,12 @@ namespace SimpleWeb {
             unsigned char hash[20];
             WSCrypto::calcSha1(inSha.c_str(), (int)inSha.size(), hash);
 
-            std::string hexString((const char*)hash);
-            hexString.resize(20);
-
-            std::string b64 = WSCrypto::base64_encode((const unsigned char *)hexString.c_str(), (int)hexString.size());
+            std::string b64 = WSCrypto::base64_encode(hash, sizeof(hash)); // The digest may hold zero bytes
 
             response_header.emplace("Sec-WebSocket-Accept", b64);
 
             try {
-              connection->endpoint = connection->socket->lowest_layer().remote_endpoint();
+              connection->endpoint = LocalSocket::remote_endpoint(connection->socket->lowest_layer());
             }
             catch(...) {
             }
@@ -591,7 +629,7 @@ namespace SimpleWeb {
 
           connection->path_match = std::move(path_match);
           connection->set_timeout(config.timeout_request);
-          asio::async_write(*connection->socket, *streambuf, [this, connection, streambuf, &regex_endpoint, status_code](const error_code &ec, std::size_t /*bytes_transferred*/) {
+          SocketWriter<socket_type>::async_write(*connection->socket, *streambuf, [this, connection, streambuf, &regex_endpoint, status_code](const error_code &ec, std::size_t /*bytes_transferred*/) {
             connection->cancel_timeout();
             auto lock = connection->handler_runner->continue_lock();
             if(!lock)
@@ -612,18 +650,45 @@ namespace SimpleWeb {
     }
 
     void read_message(const std::shared_ptr<Connection> &connection, Endpoint &endpoint) const {
+      if(config.low_footprint && connection->streambuf->size() == 0) {
+        connection->streambuf = nullptr;
+
+        // Wait for the next frame without a buffer. With TLS, the socket being readable doesn't tell if the stream has
+        // decrypted data pending, so the buffer is only reallocated.
+        if(std::is_same<socket_type, asio::ip::tcp::socket>::value) {
+          connection->set_timeout();
+          async_wait_readable(connection->socket->lowest_layer(), [this, connection, &endpoint](const error_code &ec) {
+            connection->cancel_timeout();
+            auto lock = connection->handler_runner->continue_lock();
+            if(!lock)
+              return;
+            if(!ec) {
+              connection->streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
+              read_message_header(connection, endpoint);
+            }
+            else
+              connection_error(connection, endpoint, ec);
+          });
+          return;
+        }
+        connection->streambuf = std::unique_ptr<asio::streambuf>(new asio::streambuf());
+      }
+      read_message_header(connection, endpoint);
+    }
+
+    void read_message_header(const std::shared_ptr<Connection> &connection, Endpoint &endpoint) const {
       connection->set_timeout();
-      asio::async_read(*connection->socket, connection->streambuf, asio::transfer_exactly(2), [this, connection, &endpoint](const error_code &ec, std::size_t bytes_transferred) {
+      asio::async_read(*connection->socket, *connection->streambuf, asio::transfer_exactly(2), [this, connection, &endpoint](const error_code &ec, std::size_t bytes_transferred) {
         connection->cancel_timeout();
         auto lock = connection->handler_runner->continue_lock();
         if(!lock)
           return;
         if(!ec) {
           if(bytes_transferred == 0) { // TODO: why does this happen sometimes?
-            read_message(connection, endpoint);
+            read_message_header(connection, endpoint);
             return;
           }
-          std::istream istream(&connection->streambuf);
+          std::istream istream(connection->streambuf.get());
 
           std::array<unsigned char, 2> first_bytes{};
           istream.read((char *)&first_bytes[0], 2);
@@ -643,13 +708,13 @@ namespace SimpleWeb {
           if(length == 126) {
             // 2 next bytes is the size of content
             connection->set_timeout();
-            asio::async_read(*connection->socket, connection->streambuf, asio::transfer_exactly(2), [this, connection, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
+            asio::async_read(*connection->socket, *connection->streambuf, asio::transfer_exactly(2), [this, connection, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
               connection->cancel_timeout();
               auto lock = connection->handler_runner->continue_lock();
               if(!lock)
                 return;
               if(!ec) {
-                std::istream istream(&connection->streambuf);
+                std::istream istream(connection->streambuf.get());
 
                 std::array<unsigned char, 2> length_bytes{};
                 istream.read((char *)&length_bytes[0], 2);
@@ -668,13 +733,13 @@ namespace SimpleWeb {
           else if(length == 127) {
             // 8 next bytes is the size of content
             connection->set_timeout();
-            asio::async_read(*connection->socket, connection->streambuf, asio::transfer_exactly(8), [this, connection, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
+            asio::async_read(*connection->socket, *connection->streambuf, asio::transfer_exactly(8), [this, connection, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
               connection->cancel_timeout();
               auto lock = connection->handler_runner->continue_lock();
               if(!lock)
                 return;
               if(!ec) {
-                std::istream istream(&connection->streambuf);
+                std::istream istream(connection->streambuf.get());
 
                 std::array<unsigned char, 8> length_bytes{};
                 istream.read((char *)&length_bytes[0], 8);
@@ -708,13 +773,14 @@ namespace SimpleWeb {
         return;
       }
       connection->set_timeout();
-      asio::async_read(*connection->socket, connection->streambuf, asio::transfer_exactly(4 + length), [this, connection, length, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
+      asio::async_read(*connection->socket, *connection->streambuf, asio::transfer_exactly(4 + length), [this, connection, length, &endpoint, fin_rsv_opcode](const error_code &ec, std::size_t /*bytes_transferred*/) {
         connection->cancel_timeout();
         auto lock = connection->handler_runner->continue_lock();
         if(!lock)
           return;
         if(!ec) {
-          std::istream istream(&connection->streambuf);
+          SIMPLEWEB_TRACE(auto trace_read_time = trace::now();)
+          std::istream istream(connection->streambuf.get());
 
           // Read mask
           std::array<unsigned char, 4> mask = {};
@@ -734,9 +800,12 @@ namespace SimpleWeb {
           }
           else
             in_message = std::shared_ptr<InMessage>(new InMessage(fin_rsv_opcode, length));
-          std::ostream ostream(&in_message->streambuf);
-          for(std::size_t c = 0; c < length; c++)
-            ostream.put(istream.get() ^ mask[c % 4]);
+          // The payload follows the mask in the single contiguous buffer of streambuf
+          auto source = connection->streambuf->data();
+          auto destination = in_message->streambuf.prepare(length);
+          WebSocketFrame::apply_mask(static_cast<const char *>(source.data()), static_cast<char *>(destination.data()), length, mask);
+          in_message->streambuf.commit(length);
+          connection->streambuf->consume(length);
 
           // If connection close
           if((fin_rsv_opcode & 0x0f) == 8) {
@@ -778,8 +847,10 @@ namespace SimpleWeb {
             this->read_message(connection, endpoint);
           }
           else {
+            SIMPLEWEB_TRACE(auto trace_dispatch_time = trace::now();)
             if(endpoint.on_message)
               endpoint.on_message(connection, in_message);
+            SIMPLEWEB_TRACE(trace::ring().push_inbound(connection.get(), in_message->fin_rsv_opcode, in_message->size(), trace_read_time, trace_dispatch_time, trace::now());)
 
             // Next message
             // Only reset fragmented_in_message for non-control frames (control frames can be in between a fragmented message)
@@ -800,6 +871,16 @@ namespace SimpleWeb {
 
       if(endpoint.on_open)
         endpoint.on_open(connection);
+
+      if(config.low_footprint) {
+        // Swapped with empty instances, since clear() keeps the allocated buckets and capacities
+        CaseInsensitiveMultimap().swap(connection->header);
+        regex::smatch().swap(connection->path_match);
+        std::string().swap(connection->method);
+        std::string().swap(connection->query_string);
+        std::string().swap(connection->http_version);
+        release_idle_buffers(connection);
+      }
     }
 
     void connection_close(const std::shared_ptr<Connection> &connection, Endpoint &endpoint, int status, const std::string &reason) const {
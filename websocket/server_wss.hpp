@@ -2,6 +2,7 @@
 #define SIMPLE_WEB_SERVER_WSS_HPP
 
 #include "server_ws.hpp"
+#include "../common/tls_session.hpp"
 #include <algorithm>
 #include "../openssl/ssl.h"
 
@@ -17,8 +18,6 @@ namespace SimpleWeb {
 
   template <>
   class SocketServer<WSS> : public SocketServerBase<WSS> {
-    bool set_session_id_context = false;
-
   public:
     /**
      * Constructs a server object.
@@ -36,21 +35,27 @@ namespace SimpleWeb {
         context.load_verify_file(verify_file);
         context.set_verify_mode(asio::ssl::verify_peer | asio::ssl::verify_fail_if_no_peer_cert |
                                 asio::ssl::verify_client_once);
-        set_session_id_context = true;
       }
     }
 
   protected:
+    TlsSessionResumption session_resumption; // Declared before context, which refers to it
+    TlsRecordSizing record_sizing;
     asio::ssl::context context;
+    TlsHandshakePool handshake_pool;
 
     void after_bind() override {
-      if(set_session_id_context) {
-        // Creating session_id_context from address:port but reversed due to small SSL_MAX_SSL_SESSION_ID_LENGTH
-        auto session_id_context = std::to_string(acceptor->local_endpoint().port()) + ':';
-        session_id_context.append(config.address.rbegin(), config.address.rend());
-        SSL_CTX_set_session_id_context(context.native_handle(), reinterpret_cast<const unsigned char *>(session_id_context.data()),
-                                       static_cast<unsigned int>(std::min<std::size_t>(session_id_context.size(), SSL_MAX_SSL_SESSION_ID_LENGTH)));
-      }
+      // Creating session_id_context from address:port but reversed due to small SSL_MAX_SSL_SESSION_ID_LENGTH
+      auto session_id_context = std::to_string(acceptor->local_endpoint().port()) + ':';
+      session_id_context.append(config.address.rbegin(), config.address.rend());
+      session_resumption.enable(context.native_handle(), session_id_context, config.tls_session_cache_size, config.tls_session_timeout,
+                                config.tls_session_tickets, config.tls_ticket_key_rotation);
+      record_sizing.enable(context.native_handle(), config.tls_initial_record_size, config.tls_record_ramp_bytes, config.tls_record_idle_reset);
+      handshake_pool.start(config.handshake_thread_pool_size);
+    }
+
+    void release_idle_buffers(const std::shared_ptr<Connection> &connection) const override {
+      SSL_set_mode(connection->socket->native_handle(), SSL_MODE_RELEASE_BUFFERS);
     }
 
     void accept() override {
@@ -69,13 +74,16 @@ namespace SimpleWeb {
           connection->socket->lowest_layer().set_option(option);
 
           connection->set_timeout(config.timeout_request);
-          connection->socket->async_handshake(asio::ssl::stream_base::server, [this, connection](const error_code &ec) {
+          handshake_pool.async_handshake(*connection->socket, [this, connection](const error_code &ec) {
             connection->cancel_timeout();
             auto lock = connection->handler_runner->continue_lock();
             if(!lock)
               return;
-            if(!ec)
+            if(!ec) {
+              if(config.kernel_tls)
+                KernelTls::enable(*connection->socket);
               read_handshake(connection);
+            }
           });
         }
       });